@@ -0,0 +1,502 @@
+/**
+* @file		AccuracyCheck.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The AccuracyCheck class plays synthetic notes, plucks, sweeps and noise
+* through the live tuner's analysis chain a device buffer at a time, and
+* measures how far off its readings are, how often they land an octave out and
+* how long they take to settle. Results can be stored as a baseline and later
+* runs checked against it, so changes to the chain can't quietly make the
+* tuner less accurate. Each window's reading can also be stored as a
+* reference track, so that another build (e.g. the ANALYSIS_FLOAT32 one) can
+* be checked window by window against the double-precision readings.
+**/
+
+#include "AccuracyCheck.h"
+
+// Standard includes:
+#include <iostream>
+#include <map>
+#include <fstream>
+#include <sstream>
+
+// The name --pitch takes for an estimator
+static const char* MethodName(PitchMethod method)
+{
+	switch (method) {
+	case PITCH_YIN:
+		return "yin";
+	case PITCH_MPM:
+		return "mpm";
+	case PITCH_TARGET:
+		return "target";
+	case PITCH_HPS:
+	default:
+		return "hps";
+	}
+}
+
+// ****** Constructors:
+AccuracyCheck::AccuracyCheck(TunerPresetId preset, PitchMethod method)
+	: synth(ACCURACY_DEVICE_RATE)
+{
+	this->preset = preset;
+	this->method = method;
+	this->settings = TunerPreset::GetSettings(preset);
+	this->name = std::string(this->settings.name) + "/" + MethodName(method);
+	TunerPreset::GetWindow(this->settings, method, &this->frames, &this->hop);
+	this->decimation = ACCURACY_DEVICE_RATE / this->settings.sampleRate;
+
+	// the same chain the capturer builds for the preset
+	this->context = new ProcessingContext(this->frames, this->hop);
+	this->ring = new AnalysisRing(ANALYSIS_RING_FRAMES);
+	this->pipeline = new AnalysisPipeline(&this->processor, this->context, this->ring, this->settings.sampleRate,
+										this->settings.minFrequency, this->settings.maxFrequency, ANALYSIS_WINDOW);
+	this->estimator = TunerPreset::CreateEstimator(preset, method, PITCH_REFINEMENT);
+	this->pipeline->SetEstimator(this->estimator);
+	this->pipeline->SetGate(AUDIO_USE_GATE);
+	this->pipeline->SetStats(&this->stats);
+	this->readings = NULL;
+	this->plays = 0;
+}
+
+// ****** Destructor:
+AccuracyCheck::~AccuracyCheck()
+{
+	delete this->pipeline;
+	delete this->estimator;
+	delete this->ring;
+	delete this->context;
+}
+
+// ****** Methods:
+// Play every kind of signal at each of the preset's notes, and add a result for each kind
+int AccuracyCheck::Run(std::vector<AccuracyResult>* results)
+{
+	if (this->pipeline->SetInputRate(ACCURACY_DEVICE_RATE, this->decimation) != 0 ||
+		this->pipeline->Prepare(FFT_PLANNER_FLAGS) != 0) {
+		std::cout << "***Problem setting up the analysis for " << this->name << "\n";
+		return -1;
+	}
+
+	int lead = (int)(ACCURACY_LEAD_IN * ACCURACY_DEVICE_RATE);
+	int length = (int)(ACCURACY_NOTE_SECONDS * ACCURACY_DEVICE_RATE);
+	std::vector<Sample> signal(lead + length);
+	std::vector<double> pitch(lead + length);
+	Tally note, detuned, pluck, noisy, octave;
+
+	for (int n = 0; n < this->settings.noteCount; n += 1) {
+		double frequency = this->settings.notes[n].frequency;
+		std::fill(pitch.begin(), pitch.end(), 0.0);
+		std::fill(pitch.begin() + lead, pitch.end(), frequency);
+
+		std::fill(signal.begin(), signal.end(), (Sample)0.0);
+		this->synth.Note(&signal[lead], length, frequency);
+		this->Play("note", signal, pitch, &note);
+
+		std::fill(signal.begin(), signal.end(), (Sample)0.0);
+		this->synth.Pluck(&signal[lead], length, frequency);
+		this->Play("pluck", signal, pitch, &pluck);
+
+		// the noise is scaled to the note's own RMS level
+		std::fill(signal.begin(), signal.end(), (Sample)0.0);
+		this->synth.Note(&signal[lead], length, frequency);
+		double power = 0.0;
+		for (int i = lead; i < lead + length; i += 1) {
+			power += signal[i] * signal[i];
+		}
+		this->synth.AddNoise(&signal[lead], length, sqrt(power / length) * pow(10.0, -ACCURACY_NOISE_SNR / 20.0));
+		this->Play("noisy", signal, pitch, &noisy);
+
+		std::fill(signal.begin(), signal.end(), (Sample)0.0);
+		this->synth.OctaveAmbiguous(&signal[lead], length, frequency);
+		this->Play("octave", signal, pitch, &octave);
+
+		for (int side = -1; side <= 1; side += 2) {
+			double shifted = frequency * pow(2.0, side * ACCURACY_DETUNE_CENTS / 1200.0);
+			std::fill(pitch.begin() + lead, pitch.end(), shifted);
+			std::fill(signal.begin(), signal.end(), (Sample)0.0);
+			this->synth.Note(&signal[lead], length, shifted);
+			this->Play("detuned", signal, pitch, &detuned);
+		}
+	}
+
+	this->AddResult("note", note, results);
+	this->AddResult("detuned", detuned, results);
+	this->AddResult("pluck", pluck, results);
+	this->AddResult("noisy", noisy, results);
+	this->AddResult("octave", octave, results);
+
+	// target tuning only reads the preset's own notes, so it can't follow a sweep between them
+	if (this->method != PITCH_TARGET && this->settings.noteCount > 1) {
+		double from = this->settings.notes[0].frequency;
+		double to = this->settings.notes[this->settings.noteCount - 1].frequency;
+		int sweep = (int)(ACCURACY_SWEEP_SECONDS * ACCURACY_DEVICE_RATE);
+		std::vector<Sample> glide(lead + sweep, (Sample)0.0);
+		std::vector<double> truth(lead + sweep, 0.0);
+		this->synth.Sweep(&glide[lead], sweep, from, to);
+		for (int i = 0; i < sweep; i += 1) {
+			truth[lead + i] = this->synth.SweepFrequency(i, sweep, from, to);
+		}
+
+		Tally tally;
+		this->Play("sweep", glide, truth, &tally);
+		this->AddResult("sweep", tally, results);
+	}
+
+	// a steady note, read as a stalled GUI would, so the windows after each stall show whether
+	// dropping frames put the estimator out of step with the signal
+	{
+		int stall = (int)(ACCURACY_STALL_SECONDS * ACCURACY_DEVICE_RATE);
+		double frequency = this->settings.notes[this->settings.noteCount / 2].frequency;
+		std::vector<Sample> held(lead + stall, (Sample)0.0);
+		std::vector<double> truth(lead + stall, 0.0);
+		std::fill(truth.begin() + lead, truth.end(), frequency);
+		this->synth.Note(&held[lead], stall, frequency);
+
+		Tally tally;
+		this->Play("stalled", held, truth, &tally, true);
+		this->AddResult("stalled", tally, results);
+	}
+
+	// and with nothing to find at all
+	std::fill(signal.begin(), signal.end(), (Sample)0.0);
+	std::fill(pitch.begin(), pitch.end(), 0.0);
+	this->synth.AddNoise(&signal[lead], length, pow(10.0, ACCURACY_NOISE_LEVEL / 20.0));
+	Tally noise;
+	this->Play("noise", signal, pitch, &noise);
+	this->AddResult("noise", noise, results);
+
+	return 0;
+}
+
+// Keep each scored window's reading in 'readings' (or, given NULL, stop keeping them)
+void AccuracyCheck::SetReadings(std::vector<AccuracyReading>* readings)
+{
+	this->readings = readings;
+}
+
+// Print results as a table
+void AccuracyCheck::PrintResults(const std::vector<AccuracyResult>& results)
+{
+	printf("%-14s %-8s %7s %8s %8s %8s %8s %8s %8s\n", "config", "signal", "windows", "cents", "p95", "octave",
+		"miss", "lock ms", "false");
+	for (size_t i = 0; i < results.size(); i += 1) {
+		const AccuracyResult& r = results[i];
+		printf("%-14s %-8s %7d %8.2f %8.2f %8.3f %8.3f %8.1f %8.3f\n", r.config.c_str(), r.signal.c_str(), r.windows,
+			r.cents, r.centsP95, r.octaveRate, r.missRate, r.lockTime, r.falseRate);
+	}
+}
+
+// Write results as CSV, in the form Compare reads back as a baseline
+int AccuracyCheck::WriteResults(const std::vector<AccuracyResult>& results, const std::string& path)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == NULL) {
+		std::cout << "***Problem writing " << path << "\n";
+		return -1;
+	}
+
+	fprintf(file, "config,signal,windows,cents,cents_p95,octave_rate,miss_rate,lock_ms,false_rate\n");
+	for (size_t i = 0; i < results.size(); i += 1) {
+		const AccuracyResult& r = results[i];
+		fprintf(file, "%s,%s,%d,%.3f,%.3f,%.4f,%.4f,%.1f,%.4f\n", r.config.c_str(), r.signal.c_str(), r.windows,
+			r.cents, r.centsP95, r.octaveRate, r.missRate, r.lockTime, r.falseRate);
+	}
+
+	return (fclose(file) == 0) ? 0 : -1;
+}
+
+// Check results against a baseline written by WriteResults. Every metric is better lower, and may
+// get worse by its tolerance; results the baseline doesn't cover are only reported. Returns the
+// number of regressions, or -1 if the baseline can't be read.
+int AccuracyCheck::Compare(const std::vector<AccuracyResult>& results, const std::string& baseline)
+{
+	std::ifstream file(baseline.c_str());
+	if (!file) {
+		std::cout << "***Problem reading the baseline " << baseline << "\n";
+		return -1;
+	}
+
+	std::map<std::string, AccuracyResult> expected;
+	std::string line;
+	std::getline(file, line);
+	while (std::getline(file, line)) {
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::istringstream fields(line);
+		AccuracyResult r;
+		if (fields >> r.config >> r.signal >> r.windows >> r.cents >> r.centsP95 >> r.octaveRate >> r.missRate >>
+			r.lockTime >> r.falseRate) {
+			expected[r.config + " " + r.signal] = r;
+		}
+	}
+
+	int regressions = 0;
+	for (size_t i = 0; i < results.size(); i += 1) {
+		const AccuracyResult& r = results[i];
+		std::map<std::string, AccuracyResult>::const_iterator found = expected.find(r.config + " " + r.signal);
+		if (found == expected.end()) {
+			std::cout << "No baseline for " << r.config << " " << r.signal << "\n";
+			continue;
+		}
+
+		const AccuracyResult& b = found->second;
+		const struct {
+			const char*	metric;
+			double		value;
+			double		baseline;
+			double		tolerance;
+		} checks[] = {
+			{ "cents", r.cents, b.cents, ACCURACY_CENTS_TOLERANCE },
+			{ "cents_p95", r.centsP95, b.centsP95, ACCURACY_CENTS_TOLERANCE },
+			{ "octave_rate", r.octaveRate, b.octaveRate, ACCURACY_RATE_TOLERANCE },
+			{ "miss_rate", r.missRate, b.missRate, ACCURACY_RATE_TOLERANCE },
+			{ "lock_ms", r.lockTime, b.lockTime, ACCURACY_LOCK_TOLERANCE },
+			{ "false_rate", r.falseRate, b.falseRate, ACCURACY_RATE_TOLERANCE }
+		};
+		for (int c = 0; c < (int)(sizeof(checks) / sizeof(checks[0])); c += 1) {
+			if (checks[c].value > checks[c].baseline + checks[c].tolerance) {
+				printf("***Regression: %s %s %s is %.3f (baseline %.3f)\n", r.config.c_str(), r.signal.c_str(),
+					checks[c].metric, checks[c].value, checks[c].baseline);
+				regressions += 1;
+			}
+		}
+	}
+
+	return regressions;
+}
+
+// Write scored readings as CSV, in the form CompareReadings reads back as a reference track
+int AccuracyCheck::WriteReadings(const std::vector<AccuracyReading>& readings, const std::string& path)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == NULL) {
+		std::cout << "***Problem writing " << path << "\n";
+		return -1;
+	}
+
+	fprintf(file, "config,signal,play,window,truth_hz,reading_hz\n");
+	for (size_t i = 0; i < readings.size(); i += 1) {
+		const AccuracyReading& r = readings[i];
+		fprintf(file, "%s,%s,%d,%d,%.4f,%.6f\n", r.config.c_str(), r.signal.c_str(), r.play, r.window, r.truth, r.reading);
+	}
+
+	return (fclose(file) == 0) ? 0 : -1;
+}
+
+// Check readings window by window against a reference track written by WriteReadings: each must be
+// within ACCURACY_TRACK_CENTS of the reference's, and must find a pitch exactly where the reference
+// did. Windows the reference doesn't cover are only counted. Returns the number of mismatches, or -1
+// if the reference can't be read.
+int AccuracyCheck::CompareReadings(const std::vector<AccuracyReading>& readings, const std::string& reference)
+{
+	std::ifstream file(reference.c_str());
+	if (!file) {
+		std::cout << "***Problem reading the reference track " << reference << "\n";
+		return -1;
+	}
+
+	std::map<std::string, AccuracyReading> expected;
+	std::string line;
+	std::getline(file, line);
+	while (std::getline(file, line)) {
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::istringstream fields(line);
+		AccuracyReading r;
+		if (fields >> r.config >> r.signal >> r.play >> r.window >> r.truth >> r.reading) {
+			std::ostringstream key;
+			key << r.config << " " << r.play << " " << r.window;
+			expected[key.str()] = r;
+		}
+	}
+
+	int mismatches = 0;
+	int missing = 0;
+	int compared = 0;
+	double worst = 0.0;
+	for (size_t i = 0; i < readings.size(); i += 1) {
+		const AccuracyReading& r = readings[i];
+		std::ostringstream key;
+		key << r.config << " " << r.play << " " << r.window;
+		std::map<std::string, AccuracyReading>::const_iterator found = expected.find(key.str());
+		if (found == expected.end()) {
+			missing += 1;
+			continue;
+		}
+
+		// a pitch found in only one of the two is a mismatch of its own
+		const AccuracyReading& e = found->second;
+		compared += 1;
+		double cents = 0.0;
+		bool match = ((r.reading > 0.0) == (e.reading > 0.0));
+		if (match && r.reading > 0.0) {
+			cents = 1200.0 * log(r.reading / e.reading) / log(2.0);
+			worst = std::max(worst, fabs(cents));
+			match = (fabs(cents) <= ACCURACY_TRACK_CENTS);
+		}
+		if (!match) {
+			if (mismatches < ACCURACY_TRACK_REPORTS) {
+				printf("***Mismatch: %s %s play %d window %d reads %.4f Hz (reference %.4f Hz, %+.3f cents)\n",
+					r.config.c_str(), r.signal.c_str(), r.play, r.window, r.reading, e.reading, cents);
+			}
+			mismatches += 1;
+		}
+	}
+
+	printf("%d windows compared with %s, worst difference %.4f cents, %d mismatches\n", compared, reference.c_str(),
+		worst, mismatches);
+	if (missing > 0) {
+		printf("No reference for %d windows\n", missing);
+	}
+
+	return mismatches;
+}
+
+// Play a signal (at the device rate) through the chain from a clean start, a device buffer at a
+// time, and score each window's reading against the signal's pitch at the window's centre (0 for
+// none). The readings scored are kept under 'label' too, if SetReadings asked for them. Window k covers analysis samples k * hop onwards, as every window publishes one frame.
+// With 'stall', the results are only read every so often, as from a GUI that has stalled: the ring
+// fills, the newest frames are dropped, and the readings after each stall show whether the
+// estimator kept its state in step with the windows it analysed.
+int AccuracyCheck::Play(const char* label, const std::vector<Sample>& signal, const std::vector<double>& pitch, Tally* tally,
+						bool stall)
+{
+	int onset = 0;
+	while (onset < (int)pitch.size() && pitch[onset] == 0.0 && signal[onset] == 0.0) {
+		onset += 1;
+	}
+
+	this->pipeline->Reset();
+	this->plays += 1;
+	int block = AUDIO_DEVICE_FRAMES * this->decimation;
+	int window = 0;
+	int run = 0;						// windows in a row within ACCURACY_LOCK_CENTS
+	int lockWindow = -1;				// the first of them
+	bool locked = false;
+	int blocks = 0;
+	int stallBlocks = ((ANALYSIS_RING_FRAMES + ACCURACY_STALL_DROPS) * this->hop + AUDIO_DEVICE_FRAMES - 1) / AUDIO_DEVICE_FRAMES;
+	StatsSnapshot counted;
+	this->stats.AddTo(&counted);
+	unsigned long long dropped = counted.counters[COUNTER_FRAMES_DROPPED];	// frames dropped so far, as counted by the pipeline
+
+	for (int position = 0; position < (int)signal.size(); position += block) {
+		this->pipeline->PushSamples(&signal[position], std::min(block, (int)signal.size() - position));
+		blocks += 1;
+		if (stall && blocks % stallBlocks != 0 && position + block < (int)signal.size()) {
+			continue;
+		}
+
+		// the ring kept the oldest frames, so the dropped windows come after the ones read here
+		StatsSnapshot snapshot;
+		this->stats.AddTo(&snapshot);
+		int skip = (int)(snapshot.counters[COUNTER_FRAMES_DROPPED] - dropped);
+		dropped = snapshot.counters[COUNTER_FRAMES_DROPPED];
+
+		AnalysisFrame frame;
+		while (this->ring->Pop(frame)) {
+			long long start = (long long)window * this->hop * this->decimation;
+			long long end = start + (long long)this->frames * this->decimation;
+			long long centre = std::min((long long)pitch.size() - 1, (start + end) / 2);
+			double truth = pitch[(size_t)centre];
+			double reading = frame.signal ? frame.fundamental : 0.0;
+			window += 1;
+			if (end <= onset) {
+				continue;
+			}
+
+			// a reading of noise, or an estimate to score
+			if (truth == 0.0) {
+				if (start >= onset) {
+					tally->windows += 1;
+					tally->detections += (reading > 0.0 && frame.confidence >= ACCURACY_FALSE_CONFIDENCE) ? 1 : 0;
+				}
+				continue;
+			}
+
+			double error = (reading > 0.0) ? 1200.0 * log(reading / truth) / log(2.0) : 0.0;
+			if (!locked) {
+				run = (reading > 0.0 && fabs(error) <= ACCURACY_LOCK_CENTS) ? run + 1 : 0;
+				if (run == 1) {
+					lockWindow = window - 1;
+				}
+				if (run >= ACCURACY_LOCK_FRAMES) {
+					// the reading was right from the first window of the run
+					long long lockEnd = ((long long)lockWindow * this->hop + this->frames) * this->decimation;
+					tally->lockTime += (double)(lockEnd - onset) / ACCURACY_DEVICE_RATE;
+					locked = true;
+				}
+			}
+
+			// only windows wholly within the signal are scored
+			if (start < onset) {
+				continue;
+			}
+			tally->windows += 1;
+			if (this->readings != NULL) {
+				AccuracyReading kept;
+				kept.config = this->name;
+				kept.signal = label;
+				kept.play = this->plays;
+				kept.window = window - 1;
+				kept.truth = truth;
+				kept.reading = reading;
+				this->readings->push_back(kept);
+			}
+			double octaves = floor(error / 1200.0 + 0.5);
+			if (reading <= 0.0) {
+				tally->misses += 1;
+			}
+			else if (fabs(error) <= ACCURACY_GROSS_CENTS) {
+				tally->errors.push_back(fabs(error));
+			}
+			else if (octaves != 0.0 && fabs(error - 1200.0 * octaves) <= ACCURACY_GROSS_CENTS) {
+				tally->octaves += 1;
+			}
+			else {
+				tally->misses += 1;
+			}
+		}
+		window += skip;
+	}
+
+	// a note that never locks counts as taking its whole length
+	if (pitch.back() > 0.0) {
+		if (!locked) {
+			tally->lockTime += (double)(signal.size() - onset) / ACCURACY_DEVICE_RATE;
+		}
+		tally->notes += 1;
+	}
+
+	return 0;
+}
+
+// Sum up a tally as a result
+void AccuracyCheck::AddResult(const std::string& signal, const Tally& tally, std::vector<AccuracyResult>* results) const
+{
+	AccuracyResult result;
+	result.config = this->name;
+	result.signal = signal;
+	result.windows = tally.windows;
+
+	if (!tally.errors.empty()) {
+		std::vector<double> errors(tally.errors);
+		std::sort(errors.begin(), errors.end());
+		double sum = 0.0;
+		for (size_t i = 0; i < errors.size(); i += 1) {
+			sum += errors[i];
+		}
+		result.cents = sum / errors.size();
+		result.centsP95 = errors[std::min(errors.size() - 1, (size_t)(errors.size() * 0.95))];
+	}
+	if (tally.windows > 0) {
+		result.octaveRate = (double)tally.octaves / tally.windows;
+		result.missRate = (double)tally.misses / tally.windows;
+		result.falseRate = (double)tally.detections / tally.windows;
+	}
+	if (tally.notes > 0) {
+		result.lockTime = 1000.0 * tally.lockTime / tally.notes;
+	}
+
+	results->push_back(result);
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+/**
+* @file		AccuracyCheck.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The AccuracyCheck class plays synthetic notes, plucks, sweeps and noise
+* through the live tuner's analysis chain a device buffer at a time, and
+* measures how far off its readings are, how often they land an octave out and
+* how long they take to settle. Results can be stored as a baseline and later
+* runs checked against it, so changes to the chain can't quietly make the
+* tuner less accurate. Each window's reading can also be stored as a
+* reference track, so that another build (e.g. the ANALYSIS_FLOAT32 one) can
+* be checked window by window against the double-precision readings.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <string>
+#include <vector>
+
+// Local includes:
+#include "AnalysisConfig.h"
+#include "AnalysisPipeline.h"
+#include "SignalSynth.h"
+#include "StageStats.h"
+
+// Constants:
+#define ACCURACY_DEVICE_RATE 48000		// rate the signals are generated at, and decimated from as a device's (Hz)
+#define ACCURACY_LEAD_IN 0.25			// silence before each signal (s)
+#define ACCURACY_NOTE_SECONDS 1.5		// length of each note (s)
+#define ACCURACY_SWEEP_SECONDS 4.0		// length of the sweep across the preset's notes (s)
+#define ACCURACY_STALL_SECONDS 8.0		// length of the note read with the results ring left to fill (s)
+#define ACCURACY_STALL_DROPS 4			// frames dropped each time the ring fills
+#define ACCURACY_DETUNE_CENTS 30.0		// detuned notes are this far either side of the preset's notes
+#define ACCURACY_NOISE_SNR 10.0			// signal-to-noise ratio of the noisy notes (dB)
+#define ACCURACY_NOISE_LEVEL -30.0		// RMS level of the noise on its own (dBFS)
+#define ACCURACY_FALSE_CONFIDENCE 0.5	// readings of noise this confident count as false detections
+#define ACCURACY_GROSS_CENTS 100.0		// readings further out than this are octave errors or misses
+#define ACCURACY_LOCK_CENTS 10.0		// a reading has locked when it stays this close...
+#define ACCURACY_LOCK_FRAMES 3			// ...for this many windows in a row
+#define ACCURACY_CENTS_TOLERANCE 0.5	// how much worse than the baseline an error may get (cents)
+#define ACCURACY_RATE_TOLERANCE 0.02	// how much worse than the baseline a rate may get
+#define ACCURACY_LOCK_TOLERANCE 10.0	// how much slower than the baseline locking may get (ms)
+#define ACCURACY_TRACK_CENTS 0.5		// how far a reading may be from the reference track's (cents)
+#define ACCURACY_TRACK_REPORTS 20		// mismatches listed before the rest are only counted
+
+// How one configuration did with one kind of signal
+struct AccuracyResult
+{
+	std::string	config;				// preset and estimator, e.g. "guitar/hps"
+	std::string	signal;
+	int			windows;			// windows analysed after the signals began
+	double		cents;				// mean absolute error of the usable readings (cents)
+	double		centsP95;			// 95th percentile of the absolute error (cents)
+	double		octaveRate;			// fraction of windows an octave (or more) out
+	double		missRate;			// fraction of windows with no usable reading
+	double		lockTime;			// mean time from the start of a note to a steady, correct reading (ms)
+	double		falseRate;			// fraction of windows reading a pitch in noise
+
+	AccuracyResult() {
+		windows = 0;
+		cents = 0.0;
+		centsP95 = 0.0;
+		octaveRate = 0.0;
+		missRate = 0.0;
+		lockTime = 0.0;
+		falseRate = 0.0;
+	}
+};
+
+// One scored window's reading, as stored in a reference track
+struct AccuracyReading
+{
+	std::string	config;
+	std::string	signal;
+	int			play;				// which playing of a signal, in the order Run plays them
+	int			window;				// window of that playing
+	double		truth;				// the signal's pitch (Hz)
+	double		reading;			// the estimate (Hz), or 0 for none
+
+	AccuracyReading() {
+		play = 0;
+		window = 0;
+		truth = 0.0;
+		reading = 0.0;
+	}
+};
+
+class AccuracyCheck
+{
+public:
+	// Constructors/destructors:
+	AccuracyCheck(TunerPresetId preset, PitchMethod method);
+	~AccuracyCheck();
+
+	// Methods:
+	int		Run(std::vector<AccuracyResult>* results);
+	void	SetReadings(std::vector<AccuracyReading>* readings);
+	static void	PrintResults(const std::vector<AccuracyResult>& results);
+	static int	WriteResults(const std::vector<AccuracyResult>& results, const std::string& path);
+	static int	Compare(const std::vector<AccuracyResult>& results, const std::string& baseline);
+	static int	WriteReadings(const std::vector<AccuracyReading>& readings, const std::string& path);
+	static int	CompareReadings(const std::vector<AccuracyReading>& readings, const std::string& reference);
+
+private:
+	// Readings gathered over one kind of signal
+	struct Tally
+	{
+		std::vector<double>	errors;		// absolute errors of the usable readings (cents)
+		int		windows;
+		int		octaves;
+		int		misses;
+		int		detections;				// readings of any pitch (noise only)
+		double	lockTime;				// total over the notes (s)
+		int		notes;
+
+		Tally() {
+			windows = 0;
+			octaves = 0;
+			misses = 0;
+			detections = 0;
+			lockTime = 0.0;
+			notes = 0;
+		}
+	};
+
+	// Private methods:
+	int		Play(const char* label, const std::vector<Sample>& signal, const std::vector<double>& pitch, Tally* tally,
+				bool stall = false);
+	void	AddResult(const std::string& signal, const Tally& tally, std::vector<AccuracyResult>* results) const;
+
+	// Private variables:
+	TunerPresetId		preset;
+	PitchMethod			method;
+	TunerSettings		settings;
+	std::string			name;			// "preset/estimator"
+	int					frames;			// analysis window
+	int					hop;			// analysis samples between windows
+	int					decimation;		// device samples per analysis sample
+	AudioProcessor		processor;
+	ProcessingContext*	context;
+	AnalysisRing*		ring;
+	AnalysisPipeline*	pipeline;
+	PitchEstimator*		estimator;
+	StageStats			stats;			// counts the frames dropped from a full ring
+	std::vector<AccuracyReading>*	readings;	// where to keep each scored window's reading, if anywhere
+	int					plays;			// signals played so far
+	SignalSynth			synth;
+};
\ No newline at end of file
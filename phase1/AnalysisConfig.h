@@ -0,0 +1,31 @@
+/**
+* @file		AnalysisConfig.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The analysis settings shared by the live tuner and the tools that run its
+* chain without an audio device (rt-batch, rt-bench): the preset, estimator,
+* window and planning the chain is built with. They live apart from
+* AudioCapturer.h so that the tools don't depend on RtAudio.
+*/
+
+#pragma once
+
+// Local includes:
+#include "AudioProcessor.h"
+#include "PitchEstimator.h"
+#include "TunerPreset.h"
+
+// Constants:
+#define TUNER_PRESET PRESET_BASS		// analysis rate, window sizes and note range (default: bass, B0 to E4)
+#define AUDIO_USE_GATE true			// skip the analysis of windows below the silence gate's threshold (default: true)
+#define AUDIO_DEVICE_FRAMES 256			// device buffer size when using the DSP worker, and the block size the tools feed (default: 256)
+#define PITCH_METHOD PITCH_HPS			// fundamental frequency estimator (PITCH_HPS, PITCH_YIN, PITCH_MPM or PITCH_TARGET)
+#define PITCH_REFINEMENT REFINE_PHASE_VOCODER	// sub-bin refinement of the HPS peak (default: phase vocoder)
+#define ANALYSIS_WINDOW WINDOW_HANN		// window function applied before the FFT (default: Hann)
+#define FFT_PLANNER_FLAGS FFTW_MEASURE	// FFTW planning rigour (FFTW_ESTIMATE, FFTW_MEASURE or FFTW_PATIENT)
+#ifdef ANALYSIS_FLOAT32
+#define FFT_WISDOM_FILENAME "rt-tuner-f32.wisdom"	// FFTW wisdom store, kept next to the executable (single precision)
+#else
+#define FFT_WISDOM_FILENAME "rt-tuner.wisdom"	// FFTW wisdom store, kept next to the executable
+#endif
\ No newline at end of file
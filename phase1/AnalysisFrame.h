@@ -0,0 +1,54 @@
+/**
+* @file		AnalysisFrame.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* An AnalysisFrame is the fixed-size result of analysing one window of audio,
+* handed from the audio thread to the GUI through an SpscRing.
+*/
+
+#pragma once
+
+// Local includes:
+#include "SpscRing.h"
+#include "SampleFormat.h"
+
+// Constants:
+#define ANALYSIS_MAX_BINS (8192 + 1)	// largest spectrum snapshot a frame can carry (16384-point FFT)
+#define ANALYSIS_RING_FRAMES 16			// number of frames buffered between the audio thread and the GUI
+#define ANALYSIS_MAX_TARGETS 8			// target notes a frame can report on (target tuning)
+#define ANALYSIS_MAX_CQ_BINS 128		// constant-Q bins a frame can carry (over ten octaves of semitones)
+
+struct AnalysisFrame
+{
+	double	fundamental;					// estimated fundamental frequency (Hz)
+	double	confidence;						// confidence in the estimate, 0..1
+	bool	signal;							// false if the window was gated as silent (no estimate or spectrum)
+	double	level;							// RMS level of the window (dBFS)
+	int		target;							// target note being played (-1 if not tuning to targets)
+	int		targets;						// number of target notes reported on
+	double	targetCents[ANALYSIS_MAX_TARGETS];	// each target note's deviation (cents)
+	double	targetLevel[ANALYSIS_MAX_TARGETS];	// each target note's share of the energy, 0..1
+	int		bins;							// number of valid points in the spectrum snapshot
+	Sample	spectrum[ANALYSIS_MAX_BINS];	// log-scaled magnitude spectrum (dB)
+	int		cqBins;							// number of valid points in the constant-Q snapshot
+	double	cqNote;							// MIDI note number of the first constant-Q bin
+	double	cqStep;							// semitones between constant-Q bins
+	Sample	constantQ[ANALYSIS_MAX_CQ_BINS];	// log-scaled constant-Q magnitudes, on the spectrum's scale (dB)
+	double	chroma[12];						// energy of each pitch class (C first), the strongest being 1
+
+	AnalysisFrame() {
+		fundamental = 0.0;
+		confidence = 0.0;
+		signal = false;
+		level = 0.0;
+		target = -1;
+		targets = 0;
+		bins = 0;
+		cqBins = 0;
+		cqNote = 0.0;
+		cqStep = 1.0;
+	}
+};
+
+typedef SpscRing<AnalysisFrame> AnalysisRing;
\ No newline at end of file
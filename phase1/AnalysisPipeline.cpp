@@ -0,0 +1,346 @@
+/**
+* @file		AnalysisPipeline.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The AnalysisPipeline class runs the filter, window, FFT and pitch estimation
+* chain over overlapping windows of audio and publishes each result (with a
+* constant-Q and chroma view of the spectrum) as an AnalysisFrame.
+**/
+
+#include "AnalysisPipeline.h"
+
+// ****** Constructors:
+AnalysisPipeline::AnalysisPipeline(AudioProcessor* proc, ProcessingContext* context, AnalysisRing* results,
+								double samplerate, double minfrequency, double maxfrequency, WindowType windowtype)
+{
+	this->proc = proc;
+	this->context = context;
+	this->results = results;
+	this->sampleRate = samplerate;
+	this->decimation = 1;
+	this->minFrequency = minfrequency;
+	this->maxFrequency = maxfrequency;
+	this->estimator = NULL;
+	this->windowType = windowtype;
+	this->window = NULL;
+	this->sharedLags = 0;
+	this->cqEnabled = false;
+	this->skipped = false;
+	this->stats = NULL;
+
+	// the filter coefficients only need computing once
+	this->context->filter.SetParams(samplerate, maxfrequency);
+}
+
+// ****** Methods:
+// Take input at the device's rate, decimating it by the given factor to get the analysis rate. A
+// decimating pipeline's anti-aliasing FIR takes the place of the low-pass filter. Must be called
+// before Prepare, while the stream is stopped.
+int AnalysisPipeline::SetInputRate(double devicerate, int decimation)
+{
+	if (devicerate <= 0.0 || decimation < 1) {
+		return -1;
+	}
+
+	this->decimation = decimation;
+	this->sampleRate = devicerate / decimation;
+
+	if (decimation > 1) {
+		return this->context->decimator.SetParams(decimation, devicerate, this->maxFrequency);
+	}
+
+	this->context->filter.SetParams(devicerate, this->maxFrequency);
+	return 0;
+}
+
+// Change the range of frequencies to consider. Only takes effect on the next calls to SetInputRate
+// and Prepare.
+void AnalysisPipeline::SetRange(double minfrequency, double maxfrequency)
+{
+	this->minFrequency = minfrequency;
+	this->maxFrequency = maxfrequency;
+}
+
+// Choose the pitch estimator used for every window. Only takes effect on the next call to Prepare.
+void AnalysisPipeline::SetEstimator(PitchEstimator* estimator)
+{
+	this->estimator = estimator;
+}
+
+// Enable or disable the silence gate, which skips the analysis of windows whose RMS level is below
+// the threshold; 'openlevel' and 'closelevel' (dBFS) give it hysteresis
+void AnalysisPipeline::SetGate(bool enable, double openlevel, double closelevel)
+{
+	this->context->gate.SetEnabled(enable);
+	this->context->gate.SetThresholds(openlevel, closelevel);
+}
+
+// Time each stage of the chain, and count the results dropped because the GUI fell behind, into
+// 'stats' (NULL to stop). Only the thread feeding the pipeline may record into it.
+void AnalysisPipeline::SetStats(StageStats* stats)
+{
+	this->stats = stats;
+}
+
+// Compute the constant-Q bins and chroma for every frame with a spectrum. They are only for display,
+// so this is off unless a GUI will read them. Only takes effect on the next call to Prepare.
+void AnalysisPipeline::SetConstantQ(bool enable)
+{
+	this->cqEnabled = enable;
+}
+
+// Build the FFT plan, window table and estimator state for the context's frame size. Call this
+// (from a non-real-time thread) whenever the context is resized, before feeding any samples.
+int AnalysisPipeline::Prepare(unsigned int plannerflags)
+{
+	int frames = this->context->frames;
+	if ((this->estimator == NULL || this->estimator->NeedsSpectrum()) && this->proc->PrepareFFT(frames, plannerflags) != 0) {
+		return -1;
+	}
+
+	// the constant-Q view covers the range and the first few harmonics of its highest notes
+	if (this->cqEnabled &&
+		this->constantQ.Prepare(frames, this->sampleRate, this->minFrequency, this->maxFrequency * CQT_MAX_HARMONIC) != 0) {
+		return -1;
+	}
+
+	this->window = this->proc->GetWindow(this->windowType, frames);
+	if (this->window == NULL) {
+		return -1;
+	}
+
+	if (this->estimator == NULL || this->estimator->Prepare(this->proc, frames, this->sampleRate,
+			this->minFrequency, this->maxFrequency, plannerflags) != 0) {
+		return -1;
+	}
+
+	this->skipped = false;
+
+	// when the estimator autocorrelates the whole window, derive that from the spectrum's transform
+	// rather than running a second forward FFT (cosine-sum windows only)
+	int length, lags;
+	this->sharedLags = 0;
+	if (this->estimator->Autocorrelation(&length, &lags) && length == frames && this->windowType != WINDOW_KAISER) {
+		if (this->proc->PrepareAutocorrelation(frames, plannerflags) != 0) {
+			return -1;
+		}
+		this->sharedLags = lags;
+	}
+
+	return 0;
+}
+
+// Start a new stream: forget the filter, history, gate and estimator state left by the last one.
+// Must only be called between pushes, from the thread that pushes the samples.
+void AnalysisPipeline::Reset()
+{
+	this->context->Resize(this->context->frames, this->context->history.GetHop());
+	if (this->estimator != NULL) {
+		this->estimator->Reset();
+	}
+	this->skipped = false;
+}
+
+// Feed an arbitrary number of new (device rate) samples through the low-pass filter or decimator and
+// the sliding window, analysing every window that becomes ready along the way. Returns the number of
+// windows analysed.
+int AnalysisPipeline::PushSamples(const Sample* data, int count)
+{
+	ProcessingContext* ctx = this->context;
+	int analysed = 0;
+
+	while (count > 0) {
+		// filter no further than the end of the gate's hop or the next window, so that each piece
+		// the kernels measure belongs to exactly one hop and one window
+		int room = std::min(ctx->frames, std::min(ctx->gate.GetRemaining(), ctx->history.GetNeeded()));
+		if (room <= 0) {
+			break;
+		}
+
+		// use low-pass filter to limit noise from high frequencies (or, at the device's native rate,
+		// the decimator's anti-aliasing filter); both run continuously over the stream, so each
+		// sample is filtered exactly once, and both measure the level of what they write as they go
+		SampleLevel level;
+		int chunk = std::min(count, room);
+		int filteredCount = chunk;
+		unsigned long long mark = this->Mark();
+		if (this->decimation > 1) {
+			chunk = std::min(count, ctx->decimator.InputsFor(room));
+			filteredCount = ctx->decimator.Process(data, chunk, ctx->filtered, &level);
+		}
+		else {
+			ctx->filter.Process(data, ctx->filtered, chunk, &level);
+		}
+		this->Lap(STAGE_FILTER, &mark);
+		data += chunk;
+		count -= chunk;
+
+		// the gate judges each window from those measurements on the way into the history, so quiet
+		// windows are never copied out, transformed or estimated
+		ctx->history.Push(ctx->filtered, filteredCount);
+		ctx->gate.Add(filteredCount, level);
+
+		if (ctx->history.FrameReady()) {
+			if (ctx->gate.Update()) {
+				ctx->history.ReadFrame(ctx->frame);
+				this->Process(ctx->frame, ctx->frames);
+				analysed += 1;
+			}
+			else {
+				ctx->history.SkipFrame();
+				this->PublishSilence();
+			}
+		}
+	}
+
+	return analysed;
+}
+
+// Analyse one window of (already filtered) audio and publish the result. Runs on pre-allocated
+// buffers only, so it is safe to call from the audio thread; windows the context wasn't sized for
+// are rejected.
+int AnalysisPipeline::Process(const Sample* data, int frames)
+{
+	ProcessingContext* ctx = this->context;
+	if (frames != ctx->frames || this->window == NULL || this->estimator == NULL) {
+		return -1;
+	}
+
+	// calculate the Fast Fourier Transform for the audio data, applying the windowing function
+	// (to clean up the edges of the audio sample) on the way into the FFT's input buffer. If the
+	// estimator needs the autocorrelation, that comes out of the same transform.
+	// estimators that work on the samples alone skip the transform (and the spectrum display)
+	unsigned long long mark = this->Mark();
+	bool spectrum = this->estimator->NeedsSpectrum();
+	bool shared = (spectrum && this->sharedLags > 0 &&
+		this->proc->PerformFFTAndAutocorrelation(data, frames, ctx->spectrum, this->windowType, ctx->acf, this->sharedLags,
+			SPECTRUM_MAGNITUDE, ctx->transform) == 0);
+	if (spectrum && !shared &&
+		this->proc->PerformFFT(data, frames, ctx->spectrum, this->window, SPECTRUM_MAGNITUDE, ctx->transform) != 0) {
+		return -1;
+	}
+	if (spectrum) {
+		this->Lap(STAGE_TRANSFORM, &mark);
+		this->proc->LogSpectrum(ctx->spectrum, ctx->logspectrum, ctx->bins, 1.0);
+		this->Lap(STAGE_LOG_SPECTRUM, &mark);
+	}
+
+	// determine the fundamental frequency with the chosen estimator. This runs whether or not the
+	// frame can be published, so estimators that carry state from the last window stay one hop behind
+	PitchInput input;
+	input.samples = data;
+	input.frames = frames;
+	if (spectrum) {
+		input.logspectrum = ctx->logspectrum;
+		input.bins = ctx->bins;
+		input.transform = ctx->transform;
+	}
+	input.hop = ctx->history.GetHop();
+	if (shared) {
+		input.acf = ctx->acf;
+		input.lags = this->sharedLags;
+	}
+
+	// the estimator can't carry state across windows the gate skipped
+	if (this->skipped) {
+		this->estimator->Reset();
+		this->skipped = false;
+	}
+
+	PitchEstimate estimate;
+	this->estimator->Estimate(input, &estimate);
+	this->Lap(STAGE_ESTIMATE, &mark);
+
+	// claim the next result slot; if the GUI has fallen behind, drop this frame rather than wait
+	AnalysisFrame* frame = this->results->BeginWrite();
+	if (frame == NULL) {
+		if (this->stats != NULL) {
+			this->stats->Count(COUNTER_FRAMES_DROPPED);
+		}
+		return 0;
+	}
+
+	// store the frequency data in a graph-friendly format (for plotting on a logarithmic scale)
+	frame->bins = (spectrum ? std::min(ctx->bins, ANALYSIS_MAX_BINS) : 0);
+	for (int i = 0; i < frame->bins; i += 1) {
+		frame->spectrum[i] = 10 * ctx->logspectrum[i];
+	}
+	unsigned long long handoff = this->Mark() - mark;
+	mark += handoff;
+
+	// and the constant-Q bins and chroma, read off the same transform, if anything will show them
+	frame->cqStep = 12.0 / CQT_BINS_PER_OCTAVE;
+	if (spectrum && this->cqEnabled) {
+		frame->cqBins = std::max(0, this->constantQ.Transform(ctx->transform, frame->constantQ, ANALYSIS_MAX_CQ_BINS));
+		frame->cqNote = this->constantQ.GetNote(0);
+		this->constantQ.Chroma(frame->constantQ, frame->cqBins, frame->chroma);
+		this->proc->LogSpectrum(frame->constantQ, frame->constantQ, frame->cqBins, 10.0);
+		this->Lap(STAGE_CONSTANT_Q, &mark);
+	}
+	else {
+		frame->cqBins = 0;
+		frame->cqNote = 0.0;
+		std::fill(frame->chroma, frame->chroma + CHROMA_BINS, 0.0);
+	}
+
+	// fill in the estimate
+	frame->fundamental = estimate.frequency;
+	frame->confidence = estimate.confidence;
+	frame->signal = true;
+	frame->level = ctx->gate.GetLevel();
+	frame->target = estimate.target;
+	frame->targets = std::min(estimate.targets, ANALYSIS_MAX_TARGETS);
+	for (int i = 0; i < frame->targets; i += 1) {
+		frame->targetCents[i] = estimate.targetCents[i];
+		frame->targetLevel[i] = estimate.targetLevel[i];
+	}
+
+	// hand the frame over to the GUI (the handoff's time includes copying the spectrum in, earlier)
+	this->results->CommitWrite();
+	mark -= handoff;
+	this->Lap(STAGE_HANDOFF, &mark);
+	return 0;
+}
+
+// Publish a "no signal" result for a window the gate skipped
+int AnalysisPipeline::PublishSilence()
+{
+	this->skipped = true;
+
+	AnalysisFrame* frame = this->results->BeginWrite();
+	if (frame == NULL) {
+		if (this->stats != NULL) {
+			this->stats->Count(COUNTER_FRAMES_DROPPED);
+		}
+		return 0;
+	}
+
+	frame->fundamental = 0.0;
+	frame->confidence = 0.0;
+	frame->signal = false;
+	frame->level = this->context->gate.GetLevel();
+	frame->bins = 0;
+	frame->cqBins = 0;
+	frame->target = -1;
+	frame->targets = 0;
+
+	this->results->CommitWrite();
+	return 0;
+}
+
+// Read the clock for timing a stage (0 when not timing)
+unsigned long long AnalysisPipeline::Mark() const
+{
+	return (this->stats != NULL) ? StageStats::Now() : 0;
+}
+
+// Record the time since 'mark' against a stage, and move the mark on to now
+void AnalysisPipeline::Lap(TimedStage stage, unsigned long long* mark)
+{
+	if (this->stats != NULL) {
+		unsigned long long now = StageStats::Now();
+		this->stats->Record(stage, *mark, now);
+		*mark = now;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+/**
+* @file		AnalysisPipeline.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The AnalysisPipeline class runs the filter, window, FFT and pitch estimation
+* chain over overlapping windows of audio and publishes each result (with a
+* constant-Q and chroma view of the spectrum) as an AnalysisFrame.
+*/
+
+#pragma once
+
+// Local includes:
+#include "AudioProcessor.h"
+#include "ProcessingContext.h"
+#include "AnalysisFrame.h"
+#include "PitchEstimator.h"
+#include "ConstantQ.h"
+#include "StageStats.h"
+
+class AnalysisPipeline
+{
+public:
+	// Constructors/destructors:
+	AnalysisPipeline(AudioProcessor* proc, ProcessingContext* context, AnalysisRing* results,
+					double samplerate, double minfrequency, double maxfrequency, WindowType windowtype = WINDOW_HANN);
+
+	// Methods:
+	int		SetInputRate(double devicerate, int decimation);
+	void	SetRange(double minfrequency, double maxfrequency);
+	void	SetEstimator(PitchEstimator* estimator);
+	void	SetGate(bool enable, double openlevel = GATE_OPEN_LEVEL, double closelevel = GATE_CLOSE_LEVEL);
+	void	SetStats(StageStats* stats);
+	void	SetConstantQ(bool enable);
+	int		Prepare(unsigned int plannerflags);
+	void	Reset();
+	int		PushSamples(const Sample* data, int count);
+	int		Process(const Sample* data, int frames);
+
+private:
+	// Private methods:
+	int		PublishSilence();
+	unsigned long long	Mark() const;
+	void	Lap(TimedStage stage, unsigned long long* mark);
+
+	// Private variables:
+	AudioProcessor*		proc;
+	ProcessingContext*	context;
+	AnalysisRing*		results;
+	double				sampleRate;		// analysis rate, after any decimation
+	int					decimation;		// device samples per analysis sample
+	double				minFrequency;
+	double				maxFrequency;
+	PitchEstimator*		estimator;		// fundamental frequency estimator (not owned)
+	WindowType			windowType;
+	const Sample*		window;			// window table for the context's frame size
+	ConstantQ			constantQ;		// note-aligned view of the spectrum, for display
+	bool				cqEnabled;		// whether each frame carries the constant-Q bins and chroma
+	int					sharedLags;		// lags of the autocorrelation shared with the spectrum FFT (0 if none)
+	bool				skipped;		// whether the gate has skipped windows since the last one analysed
+	StageStats*			stats;			// stage timings and counters (not owned; NULL when not timing)
+};
\ No newline at end of file
@@ -9,8 +9,12 @@
 
 #include "AudioCapturer.h"
 
+// wxWidgets includes:
+#include <wx/stdpaths.h>
+#include <wx/filename.h>
+
 // ****** Constructors:
-AudioCapturer::AudioCapturer(mpFXYVector* vector, double* totalfreq, int* freqcount) 
+AudioCapturer::AudioCapturer() 
 {
 	// initialize instance variables
 	try {
@@ -21,17 +25,26 @@ AudioCapturer::AudioCapturer(mpFXYVector* vector, double* totalfreq, int* freqco
 		exit(EXIT_FAILURE);
 	}
 
-	processor = new AudioProcessor();
-	udata = new userdata(processor, vector, totalfreq, freqcount);
+	preset = TUNER_PRESET;
+	settings = TunerPreset::GetSettings(preset);
+	udata = new userdata();
+	pipelineMode = AUDIO_USE_DSP_WORKER;
+	pitchMethod = PITCH_METHOD;
+	wisdomFile = DefaultWisdomFile();
+	bufferSeconds = 0.0;
+	udata->stats = (AUDIO_STAGE_TIMING ? new StageStats() : NULL);
+	this->SetChannels(AUDIO_NUM_CHANNELS);
 }
 
 // ****** Destructor:
 AudioCapturer::~AudioCapturer() 
 {
-	// clean up the pre-allocated instance objects
-	delete this->udata;
-	delete this->processor;
+	// clean up the pre-allocated instance objects (the device first, so the callback has stopped)
 	delete this->device;
+	this->ReleaseWorkers();
+	this->ReleaseChannels();
+	delete this->udata->stats;
+	delete this->udata;
 }
 
 // ****** Methods:
@@ -41,52 +54,55 @@ int AudioCapturer::CaptureAudio(void *outputBuffer, void *inputBuffer, unsigned
 {
 	// interpret the userData in the context of our structure
 	userdata* udata = (userdata*)userData;
+	int channels = udata->channels;
+	StageStats* stats = udata->stats;
+	unsigned long long start = (stats != NULL) ? StageStats::Now() : 0;
+	if (stats != NULL && (status & RTAUDIO_INPUT_OVERFLOW) != 0) {
+		stats->Count(COUNTER_INPUT_OVERFLOWS);
+	}
 
-	if (inputBuffer != NULL) {
-		double* data = (double*)inputBuffer;
+	if (inputBuffer != NULL && (channels == 1 || !udata->scratch.empty())) {
+		Sample* data = (Sample*)inputBuffer;
+		bool pooled = !udata->workers.empty();
 
-		// use low-pass filter to limit noise from high frequencies
-		double a[2], b[3], mem1[4], mem2[4];
-		for (int i = 0; i < 4; i += 1) {
-			mem1[i] = 0;
-			mem2[i] = 0;
-		}
-		udata->proc->CalcLowPassParams(AUDIO_SAMPLE_RATE, MAX_FREQ, a, b);
-		for (size_t i = 0; i < nBufferFrames; i += 1) {
-			// apply filter twice for good measure
-			data[i] = udata->proc->LowPass(data[i], mem1, a, b);
-			data[i] = udata->proc->LowPass(data[i], mem2, a, b);
-		}
+		// a single channel goes straight through; otherwise each channel is deinterleaved once, a
+		// scratch buffer at a time, and handed to its own pipeline
+		unsigned int piece = (channels == 1) ? nBufferFrames : (unsigned int)udata->scratch.size();
+		for (unsigned int offset = 0; offset < nBufferFrames; offset += piece) {
+			unsigned int count = std::min(piece, nBufferFrames - offset);
+			for (int c = 0; c < channels; c += 1) {
+				const Sample* samples = data + offset;
+				if (channels > 1) {
+					const Sample* in = data + offset * channels + c;
+					for (unsigned int i = 0; i < count; i += 1) {
+						udata->scratch[i] = in[i * channels];
+					}
+					samples = &udata->scratch[0];
+				}
 
-		// apply the windowing function to clean up the edges of the audio sample
-		udata->proc->ApplyWindowFunction(data, nBufferFrames);
-		// calculate the Fast Fourier Transform for the audio data
-		std::vector<double> temp = udata->proc->PerformFFT(data, nBufferFrames);
-
-		// store the frequency data in a graph-friendly format
-		std::vector<double> xs, spectrum, logspectrum;
-		for (size_t i = 0; i < (temp.size() / 2); i += 1) {
-			// for plotting on a logarithmic scale
-			logspectrum.push_back(10 * log10(temp.at(i)));
-			// for plotting on a linear scale
-			spectrum.push_back(temp.at(i));
-			xs.push_back(i);
+				if (pooled) {
+					// pipeline mode: just hand the samples over to the channel's DSP worker
+					size_t written = udata->workers[c]->PushSamples(udata->slots[c], samples, count);
+					if (stats != NULL && written < count) {
+						stats->Count(COUNTER_FIFO_DROPS, (unsigned int)(count - written));
+					}
+				}
+				else {
+					// analyse right here in the callback, whenever a new window is ready
+					udata->pipelines[c]->PushSamples(samples, count);
+				}
+			}
 		}
 
-		// Update the frequency spectrum graph
-		udata->vector->SetData(xs, logspectrum);
-		//udata->vector->SetData(xs, spectrum);
-
-		// Perform the Harmonic Product Spectrum and determine the fundamental frequency
-		int fundamentalBin = udata->proc->HPS(spectrum, AUDIO_DOWNSAMPLE_FACTOR);
-		double binSize = (double)AUDIO_SAMPLE_RATE / (double)AUDIO_BUFFER_FRAMES;
-		double fundamental = ((double)fundamentalBin * binSize);
-		
-		// accumulate frequency data over time, so we can average the results
-		*(udata->totalfreq) += fundamental;
-		*(udata->freqcount) += 1;
+		// the workers only need waking once per buffer
+		for (size_t i = 0; i < udata->pool.size(); i += 1) {
+			udata->pool[i]->Wake();
+		}
 	}
 
+	if (stats != NULL) {
+		stats->Record(STAGE_CALLBACK, start, StageStats::Now());
+	}
 	return 0;
 }
 
@@ -100,16 +116,41 @@ int AudioCapturer::InitializeAudio()
 		return -1;
 	}
 
-	// initialize the audio device input parameters
-	unsigned int bufferFrames = AUDIO_BUFFER_FRAMES, sampleRate = AUDIO_SAMPLE_RATE;
+	// the window depends on the estimator as well as the preset
+	int frames, hop;
+	TunerPreset::GetWindow(this->settings, this->pitchMethod, &frames, &hop);
+
+	// run the device at its native rate where possible (rather than have the driver resample to the
+	// analysis rate for us), and decimate by the nearest whole factor
+	unsigned int deviceId = this->device->getDefaultInputDevice();
+	int channels = this->GetChannels();
+	try {
+		unsigned int available = this->device->getDeviceInfo(deviceId).inputChannels;
+		if (available < (unsigned int)channels) {
+			std::cout << "***Problem: the input device only has " << available << " channels.\n";
+			return -1;
+		}
+	}
+	catch (RtAudioError& e) {
+		e.printMessage();
+		return -1;
+	}
+
+	unsigned int analysisRate = this->settings.sampleRate;
+	unsigned int sampleRate = (AUDIO_USE_NATIVE_RATE ? this->ChooseDeviceRate(deviceId) : analysisRate);
+	int decimation = std::max(1, (int)((sampleRate + analysisRate / 2) / analysisRate));
+
+	// initialize the audio device input parameters (buffer sizes scale with the decimation, so the
+	// latency stays the same)
+	unsigned int bufferFrames = (this->pipelineMode ? AUDIO_DEVICE_FRAMES : hop) * decimation;
 	RtAudio::StreamParameters iParams, oParams;
-	iParams.deviceId = this->device->getDefaultInputDevice();
-	iParams.nChannels = AUDIO_NUM_CHANNELS;
+	iParams.deviceId = deviceId;
+	iParams.nChannels = channels;
 	iParams.firstChannel = 0;
 	
 	// open the stream
 	try {
-		this->device->openStream(NULL, &iParams, RTAUDIO_FLOAT64, sampleRate, &bufferFrames, &AudioCapturer::CaptureAudio, (void*)udata);
+		this->device->openStream(NULL, &iParams, AUDIO_SAMPLE_FORMAT, sampleRate, &bufferFrames, &AudioCapturer::CaptureAudio, (void*)udata);
 	}
 	catch (RtAudioError& e) {
 		e.printMessage();
@@ -117,12 +158,153 @@ int AudioCapturer::InitializeAudio()
 		return -1;
 	}
 
+	this->bufferSeconds = (double)bufferFrames / sampleRate;
+
+	// room to deinterleave one channel of a device buffer at a time
+	this->udata->scratch.assign((channels > 1) ? bufferFrames : 0, 0.0);
+
+	// every channel's pipeline is set up the same way
+	this->processors[0]->LoadWisdom(this->wisdomFile);
+	bool newWisdom = false;
+	for (int c = 0; c < channels; c += 1) {
+		// size the scratch buffers for the analysis window, which no longer depends on the device buffer
+		if (this->contexts[c]->Resize(frames, hop) != 0) {
+			std::cout << "***Problem allocating the processing buffers.\n";
+			return -1;
+		}
+		if (this->pipelines[c]->SetInputRate(sampleRate, decimation) != 0) {
+			std::cout << "***Problem designing the decimation filter.\n";
+			return -1;
+		}
+
+		// plan the FFTs and build the window table up front, so that the audio path only ever uses
+		// cached ones; stored wisdom keeps this from re-measuring (and the plans measured for the
+		// first channel serve the rest)
+		if (this->pipelines[c]->Prepare(FFT_PLANNER_FLAGS) != 0) {
+			std::cout << "***Problem planning the FFT.\n";
+			return -1;
+		}
+		newWisdom = (newWisdom || this->processors[c]->HasNewWisdom());
+	}
+
+	// remember any newly measured plans for next time
+	if (newWisdom && this->processors[0]->SaveWisdom(this->wisdomFile) != 0) {
+		std::cout << "***Problem saving FFTW wisdom to " << this->wisdomFile << "\n";
+	}
+
+	// start the DSP workers before any samples arrive, with their FIFOs sized for the device rate
+	if (this->pipelineMode) {
+		if (this->StartWorkers(hop * decimation, AUDIO_FIFO_WINDOWS * this->settings.frames * decimation) != 0) {
+			std::cout << "***Problem starting the DSP worker threads.\n";
+			return -1;
+		}
+	}
+	else {
+		this->ReleaseWorkers();
+	}
+
 	// begin capturing audio
 	this->StartCapture();
 
 	return 0;
 }
 
+// Pick the rate to open the device at: the first of the usual native rates it supports, falling back
+// on the analysis rate itself
+unsigned int AudioCapturer::ChooseDeviceRate(unsigned int deviceId)
+{
+	static const unsigned int nativeRates[] = { 48000, 44100, 96000, 88200 };
+
+	RtAudio::DeviceInfo info;
+	try {
+		info = this->device->getDeviceInfo(deviceId);
+	}
+	catch (RtAudioError& e) {
+		e.printMessage();
+		return this->settings.sampleRate;
+	}
+
+	for (size_t i = 0; i < sizeof(nativeRates) / sizeof(nativeRates[0]); i += 1) {
+		if (std::find(info.sampleRates.begin(), info.sampleRates.end(), nativeRates[i]) != info.sampleRates.end()) {
+			return nativeRates[i];
+		}
+	}
+
+	return this->settings.sampleRate;
+}
+
+// Share the channels out, in contiguous groups, between a pool of DSP workers (one per core, or
+// AUDIO_MAX_WORKERS, but never more than there are channels) and start them. When DSP_WORKER_CPU
+// names a core, the first worker is pinned to it and the rest to the cores that follow.
+int AudioCapturer::StartWorkers(int hop, int fifoframes)
+{
+	this->ReleaseWorkers();
+
+	int channels = this->GetChannels();
+	int cores = std::max(1, (int)std::thread::hardware_concurrency());
+	int count = std::min(channels, (AUDIO_MAX_WORKERS > 0) ? AUDIO_MAX_WORKERS : cores);
+	int group = (channels + count - 1) / count;
+
+	this->udata->workers.assign(channels, NULL);
+	this->udata->slots.assign(channels, 0);
+	for (int first = 0; first < channels; first += group) {
+		int last = std::min(channels, first + group);
+		std::vector<AnalysisPipeline*> served(this->pipelines.begin() + first, this->pipelines.begin() + last);
+		DSPWorker* worker = new DSPWorker(served, hop, fifoframes);
+		this->workers.push_back(worker);
+
+		int cpu = DSP_WORKER_CPU;
+		if (cpu != DSP_WORKER_ANY_CPU) {
+			cpu = (cpu + (int)this->workers.size() - 1) % cores;
+		}
+		if (worker->Start(DSP_WORKER_REALTIME, cpu) != 0) {
+			return -1;
+		}
+
+		for (int c = first; c < last; c += 1) {
+			this->udata->workers[c] = worker;
+			this->udata->slots[c] = c - first;
+		}
+	}
+	this->udata->pool = this->workers;
+
+	return 0;
+}
+
+// Stop and delete the DSP workers (the stream must be closed, or analysing in the callback)
+void AudioCapturer::ReleaseWorkers()
+{
+	this->udata->workers.clear();
+	this->udata->slots.clear();
+	this->udata->pool.clear();
+
+	for (size_t i = 0; i < this->workers.size(); i += 1) {
+		delete this->workers[i];
+	}
+	this->workers.clear();
+}
+
+// Delete every channel's pipeline and the objects it works with
+void AudioCapturer::ReleaseChannels()
+{
+	this->udata->pipelines.clear();
+
+	for (size_t c = 0; c < this->pipelines.size(); c += 1) {
+		delete this->pipelines[c];
+		delete this->estimators[c];
+		delete this->contexts[c];
+		delete this->results[c];
+		delete this->processors[c];
+		delete this->stats[c];
+	}
+	this->pipelines.clear();
+	this->estimators.clear();
+	this->contexts.clear();
+	this->results.clear();
+	this->processors.clear();
+	this->stats.clear();
+}
+
 // Begin the audio capturing process
 int AudioCapturer::StartCapture() 
 {
@@ -168,5 +350,158 @@ int AudioCapturer::CloseStream()
 		}
 	}
 
+	// with no more samples coming, the DSP workers can finish too
+	for (size_t i = 0; i < this->workers.size(); i += 1) {
+		this->workers[i]->Stop();
+	}
+
+	return 0;
+}
+
+// Choose between analysing on the DSP worker thread or directly in the audio callback. Only takes
+// effect on the next call to InitializeAudio.
+void AudioCapturer::SetPipelineMode(bool useworker)
+{
+	this->pipelineMode = useworker;
+}
+
+// Choose the fundamental frequency estimator. Only takes effect on the next call to InitializeAudio,
+// and must not be called while the stream is running.
+void AudioCapturer::SetPitchMethod(PitchMethod method)
+{
+	this->pitchMethod = method;
+	for (size_t c = 0; c < this->pipelines.size(); c += 1) {
+		delete this->estimators[c];
+		this->estimators[c] = TunerPreset::CreateEstimator(this->preset, method, PITCH_REFINEMENT);
+		this->pipelines[c]->SetEstimator(this->estimators[c]);
+	}
+}
+
+// Choose the instrument preset (analysis rate, window sizes and note range). Only takes effect on
+// the next call to InitializeAudio, and must not be called while the stream is running.
+void AudioCapturer::SetPreset(TunerPresetId preset)
+{
+	this->preset = preset;
+	this->settings = TunerPreset::GetSettings(preset);
+	for (size_t c = 0; c < this->pipelines.size(); c += 1) {
+		this->pipelines[c]->SetRange(this->settings.minFrequency, this->settings.maxFrequency);
+	}
+
+	// the HPS estimator is specialised on the preset
+	this->SetPitchMethod(this->pitchMethod);
+}
+
+// Get the configuration of the current preset
+const TunerSettings& AudioCapturer::GetSettings() const
+{
+	return this->settings;
+}
+
+// Choose how many input channels (from the first) to capture. Each is analysed by its own pipeline
+// and publishes its own results. Only takes effect on the next call to InitializeAudio, and must not
+// be called while the stream is running.
+void AudioCapturer::SetChannels(int channels)
+{
+	this->ReleaseWorkers();
+	this->ReleaseChannels();
+
+	channels = std::max(1, channels);
+	for (int c = 0; c < channels; c += 1) {
+		AudioProcessor* processor = new AudioProcessor();
+		ProcessingContext* context = new ProcessingContext(this->settings.frames, this->settings.hop);
+		AnalysisRing* ring = new AnalysisRing(ANALYSIS_RING_FRAMES);
+		AnalysisPipeline* pipeline = new AnalysisPipeline(processor, context, ring, this->settings.sampleRate,
+														this->settings.minFrequency, this->settings.maxFrequency, ANALYSIS_WINDOW);
+		PitchEstimator* estimator = TunerPreset::CreateEstimator(this->preset, this->pitchMethod, PITCH_REFINEMENT);
+		pipeline->SetEstimator(estimator);
+		pipeline->SetGate(AUDIO_USE_GATE);
+		pipeline->SetConstantQ(SPECTRUM_CONSTANT_Q);
+		StageStats* timing = (AUDIO_STAGE_TIMING ? new StageStats() : NULL);
+		pipeline->SetStats(timing);
+
+		this->processors.push_back(processor);
+		this->contexts.push_back(context);
+		this->results.push_back(ring);
+		this->pipelines.push_back(pipeline);
+		this->estimators.push_back(estimator);
+		this->stats.push_back(timing);
+	}
+
+	this->udata->channels = channels;
+	this->udata->pipelines = this->pipelines;
+}
+
+// Get the number of channels captured
+int AudioCapturer::GetChannels() const
+{
+	return (int)this->pipelines.size();
+}
+
+// Get the queue of analysis results produced by the audio thread for a channel (the GUI is its only
+// consumer)
+AnalysisRing* AudioCapturer::GetResults(int channel)
+{
+	return this->results[channel];
+}
+
+// Take a snapshot of the audio path's timings and counters: the callback's, and every channel's
+// pipeline's, merged. Safe to call while the stream is running. Returns -1 if timing is off.
+int AudioCapturer::GetStats(StatsSnapshot* snapshot) const
+{
+	snapshot->Clear();
+	if (this->udata->stats == NULL) {
+		return -1;
+	}
+
+	this->udata->stats->AddTo(snapshot);
+	for (size_t c = 0; c < this->stats.size(); c += 1) {
+		if (this->stats[c] != NULL) {
+			this->stats[c]->AddTo(snapshot);
+		}
+	}
+
+	return 0;
+}
+
+// Get the length of a device buffer (s), which the callback must keep well within
+double AudioCapturer::GetBufferSeconds() const
+{
+	return this->bufferSeconds;
+}
+
+// Set the location of the FFTW wisdom store (an empty path disables it)
+void AudioCapturer::SetWisdomFile(const std::string& path)
+{
+	this->wisdomFile = path;
+}
+
+// Default location of the FFTW wisdom store: alongside the executable
+std::string AudioCapturer::DefaultWisdomFile()
+{
+	wxFileName file(wxStandardPaths::Get().GetExecutablePath());
+	file.SetFullName(wxT(FFT_WISDOM_FILENAME));
+
+	return std::string(file.GetFullPath().mb_str());
+}
+
+// Measure plans for each of the given FFT sizes and add them to the wisdom store
+int AudioCapturer::GenerateWisdom(const std::vector<int>& sizes, const std::string& path)
+{
+	AudioProcessor proc;
+	proc.LoadWisdom(path);
+
+	for (size_t i = 0; i < sizes.size(); i += 1) {
+		std::cout << "Planning " << sizes[i] << "-point FFT...\n";
+		if (proc.PrepareFFT(sizes[i], FFT_PLANNER_FLAGS) != 0) {
+			std::cout << "***Problem planning the FFT.\n";
+			return -1;
+		}
+	}
+
+	if (proc.SaveWisdom(path) != 0) {
+		std::cout << "***Problem saving FFTW wisdom to " << path << "\n";
+		return -1;
+	}
+
 	return 0;
 }
\ No newline at end of file
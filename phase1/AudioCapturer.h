@@ -13,43 +13,53 @@
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
 
 // Local includes:
+#include "AnalysisConfig.h"
 #include "AudioProcessor.h"
+#include "ProcessingContext.h"
+#include "AnalysisFrame.h"
+#include "AnalysisPipeline.h"
+#include "PitchEstimator.h"
+#include "TunerPreset.h"
+#include "DSPWorker.h"
+#include "StageStats.h"
 #include "RTAudio\RTAudio.h"
-#include "wxmathplot\mathplot.h"
 
-// Constants:
-#define AUDIO_NUM_CHANNELS 1			// number of audio channels to use (default: 1)
-#define AUDIO_SAMPLE_RATE 8000			// audio sample rate (default: 8000)
-#define AUDIO_BUFFER_FRAMES 4096		// number of sample frames (default: 4096)
-#define AUDIO_DOWNSAMPLE_FACTOR 4		// number of times to downsample, used for HPS algorithm (default: 4)
-#define MAX_FREQ 330					// the highest frequency to consider (default: C4, or ~262 Hz)
-#define MIN_FREQ 29						// the lowest frequency to consider (default: B0, or ~30 Hz)
+// Constants (see AnalysisConfig.h for the analysis settings the tools share):
+#define AUDIO_NUM_CHANNELS 1			// number of audio channels to capture, each analysed on its own (default: 1)
+#define AUDIO_MAX_WORKERS 0				// DSP workers the channels are shared out between (default: 0, one per core)
+#define AUDIO_USE_NATIVE_RATE true		// open the device at its native rate and decimate to the analysis rate (default: true)
+#define AUDIO_USE_DSP_WORKER true		// analyse on a worker thread instead of in the callback (default: true)
+#define AUDIO_FIFO_WINDOWS 4			// analysis windows of samples the FIFO between the callback and the DSP worker holds (default: 4)
+#define DSP_WORKER_REALTIME false		// run the DSP worker at real-time priority (default: false)
+#define DSP_WORKER_CPU DSP_WORKER_ANY_CPU	// core to pin the first DSP worker to, the rest following on (default: any)
+#define AUDIO_STAGE_TIMING true		// time each stage of the audio path, for the Diagnostics tab (default: true)
+#define SPECTRUM_CONSTANT_Q true		// compute (and plot) note-aligned constant-Q bins and chroma rather than every FFT bin (default: true)
 
 // Forward declarations:
 class AudioProcessor;
+class ProcessingContext;
+class AnalysisPipeline;
+class PitchEstimator;
+class DSPWorker;
 
 // Structure giving the RtAudio callback function access to the features that it needs
 struct userdata
 {
-	AudioProcessor*		proc;
-	mpFXYVector*		vector;
-	double*				totalfreq;
-	int*				freqcount;
+	int								channels;	// channels interleaved in each device buffer
+	std::vector<AnalysisPipeline*>	pipelines;	// each channel's pipeline
+	std::vector<DSPWorker*>			workers;	// each channel's DSP worker (empty when analysing directly in the callback)
+	std::vector<int>				slots;		// each channel's place among its worker's channels
+	std::vector<DSPWorker*>			pool;		// every DSP worker, to wake once per buffer
+	std::vector<Sample>				scratch;	// one channel of a device buffer, deinterleaved
+	StageStats*						stats;		// the callback's timings and counters (NULL when not timing)
 
 	userdata() {
-		proc = NULL;
-		vector = NULL;
-		totalfreq = NULL;
-		freqcount = NULL;
-	}
-
-	userdata(AudioProcessor* p, mpFXYVector* v, double* f, int* c) {
-		proc = p;
-		vector = v;
-		totalfreq = f;
-		freqcount = c;
+		channels = 1;
+		stats = NULL;
 	}
 };
 
@@ -58,7 +68,7 @@ class AudioCapturer
 {
 public:
 	// Constructors/destructors:
-	AudioCapturer(mpFXYVector* vec, double* totfreq, int* freqcount);
+	AudioCapturer();
 	~AudioCapturer();
 
 	// Instance variables:
@@ -71,9 +81,40 @@ public:
 	int			StartCapture();
 	int			StopCapture();
 	int			CloseStream();
+	void		SetWisdomFile(const std::string& path);
+	void		SetPipelineMode(bool useworker);
+	void		SetPitchMethod(PitchMethod method);
+	void		SetPreset(TunerPresetId preset);
+	const TunerSettings&	GetSettings() const;
+	void		SetChannels(int channels);
+	int			GetChannels() const;
+	AnalysisRing*	GetResults(int channel = 0);
+	int			GetStats(StatsSnapshot* snapshot) const;
+	double		GetBufferSeconds() const;
+	static std::string	DefaultWisdomFile();
+	static int	GenerateWisdom(const std::vector<int>& sizes, const std::string& path);
 
 private:
+	// Private methods:
+	unsigned int	ChooseDeviceRate(unsigned int deviceId);
+	int				StartWorkers(int hop, int fifoframes);
+	void			ReleaseWorkers();
+	void			ReleaseChannels();
+
 	// Private variables:
-	AudioProcessor*		processor;
+	// -- one of each per channel (FFT plans and work buffers aren't shared between threads)
+	std::vector<AudioProcessor*>	processors;
+	std::vector<ProcessingContext*>	contexts;
+	std::vector<AnalysisRing*>		results;	// analysis frames, from the audio thread to the GUI
+	std::vector<AnalysisPipeline*>	pipelines;
+	std::vector<PitchEstimator*>	estimators;
+	std::vector<DSPWorker*>			workers;	// the pool the channels are shared out between
+	std::vector<StageStats*>		stats;		// each pipeline's timings (NULL when not timing)
 	RtAudio*			device;
+	bool				pipelineMode;		// analyse on the DSP worker rather than in the callback
+	PitchMethod			pitchMethod;
+	TunerPresetId		preset;
+	TunerSettings		settings;			// the preset's configuration
+	std::string			wisdomFile;
+	double				bufferSeconds;		// length of a device buffer, the callback's time budget
 };
\ No newline at end of file
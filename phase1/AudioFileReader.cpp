@@ -0,0 +1,310 @@
+/**
+* @file		AudioFileReader.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The AudioFileReader class streams recorded audio (WAV, or headerless raw
+* PCM) from disk as mono samples, a block at a time, so files of any length
+* can be analysed offline. Reads can start anywhere in the file.
+**/
+
+#include "AudioFileReader.h"
+
+// Standard includes:
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+// 64-bit file offsets, for recordings past 2 GB
+#ifdef _WIN32
+#define AUDIO_FILE_SEEK _fseeki64
+#define AUDIO_FILE_TELL _ftelli64
+#else
+#define AUDIO_FILE_SEEK fseeko
+#define AUDIO_FILE_TELL ftello
+#endif
+
+// WAV format tags
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_FLOAT 0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+// Little-endian fields of a header
+static unsigned int ReadLE(const unsigned char* p, int bytes)
+{
+	unsigned int value = 0;
+	for (int i = bytes - 1; i >= 0; i -= 1) {
+		value = (value << 8) | p[i];
+	}
+
+	return value;
+}
+
+// ****** Constructors:
+AudioFileReader::AudioFileReader()
+{
+	file = NULL;
+	position = 0;
+}
+
+// ****** Destructor:
+AudioFileReader::~AudioFileReader()
+{
+	this->Close();
+}
+
+// ****** Methods:
+// Open a file for reading. WAV files describe themselves; anything else is read as raw PCM laid out
+// as 'raw' says (its frame count, if zero, is worked out from the file size). Opening a file with the
+// format another reader found is how several threads read the same file.
+int AudioFileReader::Open(const std::string& path, const AudioFileFormat* raw)
+{
+	this->Close();
+
+	this->file = fopen(path.c_str(), "rb");
+	if (this->file == NULL) {
+		std::cout << "***Problem opening " << path << "\n";
+		return -1;
+	}
+	this->path = path;
+
+	if (raw == NULL) {
+		if (this->ReadWavHeader() != 0) {
+			std::cout << "***Problem reading " << path << " (not a PCM or float WAV file)\n";
+			this->Close();
+			return -1;
+		}
+	}
+	else {
+		this->format = *raw;
+		if (this->format.frames <= 0) {
+			AUDIO_FILE_SEEK(this->file, 0, SEEK_END);
+			long long size = AUDIO_FILE_TELL(this->file) - this->format.dataOffset;
+			this->format.frames = size / (BytesPerSample(this->format.encoding) * this->format.channels);
+		}
+	}
+
+	if (this->format.sampleRate <= 0 || this->format.channels <= 0) {
+		std::cout << "***Problem reading " << path << " (no sample rate or channels)\n";
+		this->Close();
+		return -1;
+	}
+
+	return this->Seek(0);
+}
+
+// Close the file
+void AudioFileReader::Close()
+{
+	if (this->file != NULL) {
+		fclose(this->file);
+		this->file = NULL;
+	}
+	this->position = 0;
+}
+
+// Move to a sample frame, for the next Read
+int AudioFileReader::Seek(long long frame)
+{
+	if (this->file == NULL || frame < 0 || frame > this->format.frames) {
+		return -1;
+	}
+
+	long long frameBytes = BytesPerSample(this->format.encoding) * this->format.channels;
+	if (AUDIO_FILE_SEEK(this->file, this->format.dataOffset + frame * frameBytes, SEEK_SET) != 0) {
+		return -1;
+	}
+	this->position = frame;
+
+	return 0;
+}
+
+// Read up to 'frames' sample frames as mono samples in -1..1: one channel of them, or the average of
+// all channels. Returns the number read (0 at the end of the file), or -1 on error.
+int AudioFileReader::Read(Sample* out, int frames, int channel)
+{
+	if (this->file == NULL || channel >= this->format.channels) {
+		return -1;
+	}
+
+	frames = (int)std::min((long long)frames, this->format.frames - this->position);
+	if (frames <= 0) {
+		return 0;
+	}
+
+	int channels = this->format.channels;
+	int width = BytesPerSample(this->format.encoding);
+	this->bytes.resize((size_t)frames * channels * width);
+	frames = (int)(fread(&this->bytes[0], (size_t)channels * width, frames, this->file));
+	this->position += frames;
+
+	int first = (channel == AUDIO_FILE_MIX) ? 0 : channel;
+	int last = (channel == AUDIO_FILE_MIX) ? channels - 1 : channel;
+	double scale = 1.0 / (last - first + 1);
+	for (int i = 0; i < frames; i += 1) {
+		double sum = 0.0;
+		for (int c = first; c <= last; c += 1) {
+			const unsigned char* p = &this->bytes[((size_t)i * channels + c) * width];
+			switch (this->format.encoding) {
+			case PCM_INT16:
+				sum += (short)ReadLE(p, 2) / 32768.0;
+				break;
+			case PCM_INT24:
+				sum += ((int)(ReadLE(p, 3) << 8) >> 8) / 8388608.0;
+				break;
+			case PCM_INT32:
+				sum += (int)ReadLE(p, 4) / 2147483648.0;
+				break;
+			case PCM_FLOAT32: {
+				float value;
+				memcpy(&value, p, sizeof(value));
+				sum += value;
+				break;
+			}
+			case PCM_FLOAT64: {
+				double value;
+				memcpy(&value, p, sizeof(value));
+				sum += value;
+				break;
+			}
+			}
+		}
+		out[i] = (Sample)(sum * scale);
+	}
+
+	return frames;
+}
+
+// Get the layout of the open file
+const AudioFileFormat& AudioFileReader::GetFormat() const
+{
+	return this->format;
+}
+
+// Get the path of the open file
+const std::string& AudioFileReader::GetPath() const
+{
+	return this->path;
+}
+
+// Map an encoding name ("s16", "s24", "s32", "f32" or "f64") onto its PcmEncoding; returns false if
+// unknown
+bool AudioFileReader::ParseEncoding(const std::string& name, PcmEncoding* encoding)
+{
+	if (name == "s16") {
+		*encoding = PCM_INT16;
+	}
+	else if (name == "s24") {
+		*encoding = PCM_INT24;
+	}
+	else if (name == "s32") {
+		*encoding = PCM_INT32;
+	}
+	else if (name == "f32") {
+		*encoding = PCM_FLOAT32;
+	}
+	else if (name == "f64") {
+		*encoding = PCM_FLOAT64;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+// Size of one sample of an encoding, in bytes
+int AudioFileReader::BytesPerSample(PcmEncoding encoding)
+{
+	switch (encoding) {
+	case PCM_INT24:
+		return 3;
+	case PCM_INT32:
+	case PCM_FLOAT32:
+		return 4;
+	case PCM_FLOAT64:
+		return 8;
+	case PCM_INT16:
+	default:
+		return 2;
+	}
+}
+
+// Walk the RIFF chunks for the format and the sample data
+int AudioFileReader::ReadWavHeader()
+{
+	unsigned char header[12];
+	if (fread(header, 1, sizeof(header), this->file) != sizeof(header) ||
+		memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+		return -1;
+	}
+
+	bool haveFormat = false;
+	unsigned char chunk[8];
+	while (fread(chunk, 1, sizeof(chunk), this->file) == sizeof(chunk)) {
+		long long size = ReadLE(chunk + 4, 4);
+
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			unsigned char fmt[40];
+			memset(fmt, 0, sizeof(fmt));
+			size_t got = fread(fmt, 1, (size_t)std::min(size, (long long)sizeof(fmt)), this->file);
+			if (got < 16) {
+				return -1;
+			}
+
+			// the extensible format keeps the real tag at the start of its sub-format GUID
+			unsigned int tag = ReadLE(fmt, 2);
+			if (tag == WAV_FORMAT_EXTENSIBLE && got >= 26) {
+				tag = ReadLE(fmt + 24, 2);
+			}
+			this->format.channels = ReadLE(fmt + 2, 2);
+			this->format.sampleRate = ReadLE(fmt + 4, 4);
+			unsigned int bits = ReadLE(fmt + 14, 2);
+			if (this->format.channels == 0) {
+				return -1;
+			}
+
+			if (tag == WAV_FORMAT_PCM && bits == 16) {
+				this->format.encoding = PCM_INT16;
+			}
+			else if (tag == WAV_FORMAT_PCM && bits == 24) {
+				this->format.encoding = PCM_INT24;
+			}
+			else if (tag == WAV_FORMAT_PCM && bits == 32) {
+				this->format.encoding = PCM_INT32;
+			}
+			else if (tag == WAV_FORMAT_FLOAT && bits == 32) {
+				this->format.encoding = PCM_FLOAT32;
+			}
+			else if (tag == WAV_FORMAT_FLOAT && bits == 64) {
+				this->format.encoding = PCM_FLOAT64;
+			}
+			else {
+				return -1;
+			}
+			haveFormat = true;
+			AUDIO_FILE_SEEK(this->file, (size - (long long)got) + (size & 1), SEEK_CUR);
+		}
+		else if (memcmp(chunk, "data", 4) == 0) {
+			if (!haveFormat) {
+				return -1;
+			}
+			this->format.dataOffset = AUDIO_FILE_TELL(this->file);
+
+			// recorders that were cut off (or files past 4 GB) leave the size wrong: trust the file's
+			AUDIO_FILE_SEEK(this->file, 0, SEEK_END);
+			long long available = AUDIO_FILE_TELL(this->file) - this->format.dataOffset;
+			if (size == 0 || size > available) {
+				size = available;
+			}
+			this->format.frames = size / (BytesPerSample(this->format.encoding) * this->format.channels);
+			return 0;
+		}
+		else {
+			// chunks are padded to an even size
+			AUDIO_FILE_SEEK(this->file, size + (size & 1), SEEK_CUR);
+		}
+	}
+
+	return -1;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+/**
+* @file		AudioFileReader.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The AudioFileReader class streams recorded audio (WAV, or headerless raw
+* PCM) from disk as mono samples, a block at a time, so files of any length
+* can be analysed offline. Reads can start anywhere in the file.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Local includes:
+#include "SampleFormat.h"
+
+// Constants:
+#define AUDIO_FILE_MIX -1				// read the average of all channels rather than a single one
+
+// Sample encodings the reader understands (little-endian)
+enum PcmEncoding
+{
+	PCM_INT16,
+	PCM_INT24,
+	PCM_INT32,
+	PCM_FLOAT32,
+	PCM_FLOAT64
+};
+
+// Layout of the sample data in a file
+struct AudioFileFormat
+{
+	int			sampleRate;			// Hz
+	int			channels;			// interleaved channels
+	PcmEncoding	encoding;
+	long long	dataOffset;			// byte offset of the first sample frame
+	long long	frames;				// sample frames in the file
+
+	AudioFileFormat() {
+		sampleRate = 0;
+		channels = 1;
+		encoding = PCM_INT16;
+		dataOffset = 0;
+		frames = 0;
+	}
+};
+
+class AudioFileReader
+{
+public:
+	// Constructors/destructors:
+	AudioFileReader();
+	~AudioFileReader();
+
+	// Methods:
+	int		Open(const std::string& path, const AudioFileFormat* raw = NULL);
+	void	Close();
+	int		Seek(long long frame);
+	int		Read(Sample* out, int frames, int channel = AUDIO_FILE_MIX);
+	const AudioFileFormat&	GetFormat() const;
+	const std::string&		GetPath() const;
+
+	static bool	ParseEncoding(const std::string& name, PcmEncoding* encoding);
+	static int	BytesPerSample(PcmEncoding encoding);
+
+private:
+	// Private methods:
+	int		ReadWavHeader();
+
+	// Private variables:
+	FILE*						file;
+	std::string					path;
+	AudioFileFormat				format;
+	long long					position;	// the next sample frame to read
+	std::vector<unsigned char>	bytes;		// raw sample frames, on their way to conversion
+};
\ No newline at end of file
@@ -9,52 +9,436 @@
 
 #include "AudioProcessor.h"
 
-// Fast Fourier Transform method for converting a raw audio	data to the frequency domain
-std::vector<double> AudioProcessor::PerformFFT(double* data, int fftsize)
+// ****** Constructors:
+AudioProcessor::AudioProcessor()
 {
-	// allocate space for the output vector
-	fftw_complex* out;
-	out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * fftsize);
-	
-	// calculate the FFTW real-to-complex "plan"
-	fftw_plan p;
-	p = fftw_plan_dft_r2c_1d(fftsize, data, out, FFTW_ESTIMATE);
-	
-	// execute the FFT and discard the plan when finished
-	fftw_execute(p);
-	fftw_destroy_plan(p);
-	
-	// Calculate the magnitude of the spectrum data
-	std::vector<double> spectrum;
-	double re, im;
-	for (int i = 0; i < fftsize; i += 1) {
-		re = out[i][0];
-		im = out[i][1];
-		spectrum.push_back( sqrt(re*re + im*im) );
+	newWisdom = false;
+}
+
+// ****** Destructor:
+AudioProcessor::~AudioProcessor()
+{
+	// release every cached plan and its buffers
+	this->ClearPlans();
+
+	// release the window tables
+	std::map<std::pair<int, int>, Sample*>::iterator it;
+	for (it = this->windows.begin(); it != this->windows.end(); ++it) {
+		FFTW(free)(it->second);
+	}
+}
+
+// ****** Methods:
+// Build (or reuse) the FFTW plan for the given transform size and input alignment. Planning is
+// expensive and not thread-safe, so this should be called before the audio stream is started.
+int AudioProcessor::PrepareFFT(int fftsize, unsigned int flags, int alignment)
+{
+	if (fftsize <= 0) {
+		return -1;
+	}
+
+	// nothing to do if a plan for this size/alignment already exists
+	if (this->FindPlan(fftsize, alignment) != NULL) {
+		return 0;
+	}
+
+	// allocate aligned work buffers; these are reused for every transform of this size
+	FFTPlan entry;
+	entry.size = fftsize;
+	entry.alignment = alignment;
+	entry.in = (Sample*)FFTW(malloc)(sizeof(Sample) * fftsize);
+	entry.out = (SampleComplex*)FFTW(malloc)(sizeof(SampleComplex) * fftsize);
+	if (entry.in == NULL || entry.out == NULL) {
+		FFTW(free)(entry.in);
+		FFTW(free)(entry.out);
+		return -1;
+	}
+
+	// plans for anything other than the default alignment must accept arbitrarily aligned arrays
+	if (alignment != FFT_DEFAULT_ALIGNMENT) {
+		flags |= FFTW_UNALIGNED;
+	}
+
+	// calculate the FFTW real-to-complex "plan" (measuring planners overwrite the buffers)
+	entry.plan = this->MakePlan(false, fftsize, entry.in, entry.out, flags);
+	if (entry.plan == NULL) {
+		FFTW(free)(entry.in);
+		FFTW(free)(entry.out);
+		return -1;
+	}
+
+	memset(entry.in, 0, sizeof(Sample) * fftsize);
+	memset(entry.out, 0, sizeof(SampleComplex) * fftsize);
+	this->plans[std::make_pair(fftsize, alignment)] = entry;
+
+	return 0;
+}
+
+// Create a real-to-complex (or, if 'inverse', complex-to-real) plan. The loaded wisdom is tried
+// first, and the planner only measures when it has nothing for this transform.
+SamplePlan AudioProcessor::MakePlan(bool inverse, int fftsize, Sample* real, SampleComplex* complex, unsigned int flags)
+{
+	SamplePlan plan = NULL;
+	if ((flags & FFTW_ESTIMATE) == 0) {
+		plan = inverse ? FFTW(plan_dft_c2r_1d)(fftsize, complex, real, flags | FFTW_WISDOM_ONLY)
+					   : FFTW(plan_dft_r2c_1d)(fftsize, real, complex, flags | FFTW_WISDOM_ONLY);
+		if (plan != NULL) {
+			return plan;
+		}
+	}
+
+	plan = inverse ? FFTW(plan_dft_c2r_1d)(fftsize, complex, real, flags)
+				   : FFTW(plan_dft_r2c_1d)(fftsize, real, complex, flags);
+
+	// a measured plan adds wisdom worth saving
+	if (plan != NULL && (flags & FFTW_ESTIMATE) == 0) {
+		this->newWisdom = true;
+	}
+
+	return plan;
+}
+
+// Destroy all cached plans and free their buffers
+void AudioProcessor::ClearPlans()
+{
+	std::map<std::pair<int, int>, FFTPlan>::iterator it;
+	for (it = this->plans.begin(); it != this->plans.end(); ++it) {
+		FFTW(destroy_plan)(it->second.plan);
+		FFTW(free)(it->second.in);
+		FFTW(free)(it->second.out);
+	}
+
+	std::map<int, ACFPlan>::iterator acf;
+	for (acf = this->acfPlans.begin(); acf != this->acfPlans.end(); ++acf) {
+		FFTW(destroy_plan)(acf->second.forward);
+		FFTW(destroy_plan)(acf->second.inverse);
+		FFTW(free)(acf->second.in);
+		FFTW(free)(acf->second.spectrum);
+		FFTW(free)(acf->second.windowed);
+		FFTW(free)(acf->second.out);
+	}
+
+	this->plans.clear();
+	this->acfPlans.clear();
+}
+
+// Import previously accumulated FFTW wisdom, so that measured plans can be recreated quickly
+int AudioProcessor::LoadWisdom(const std::string& path)
+{
+	if (path.empty() || FFTW(import_wisdom_from_filename)(path.c_str()) == 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+// Export the FFTW wisdom gathered so far, so later runs can skip the measuring step
+int AudioProcessor::SaveWisdom(const std::string& path)
+{
+	if (path.empty() || FFTW(export_wisdom_to_filename)(path.c_str()) == 0) {
+		return -1;
+	}
+
+	this->newWisdom = false;
+	return 0;
+}
+
+// Look up a cached plan, returning NULL if none has been prepared
+FFTPlan* AudioProcessor::FindPlan(int fftsize, int alignment)
+{
+	std::map<std::pair<int, int>, FFTPlan>::iterator it = this->plans.find(std::make_pair(fftsize, alignment));
+	if (it == this->plans.end()) {
+		return NULL;
+	}
+
+	return &it->second;
+}
+
+// Build (or reuse) the table for the given window function and size. Like planning, this
+// allocates, so it should be done before the audio stream is started.
+int AudioProcessor::PrepareWindow(WindowType type, int size)
+{
+	if (size <= 1) {
+		return -1;
+	}
+
+	std::pair<int, int> key((int)type, size);
+	if (this->windows.find(key) != this->windows.end()) {
+		return 0;
+	}
+
+	Sample* table = (Sample*)FFTW(malloc)(sizeof(Sample) * size);
+	if (table == NULL) {
+		return -1;
+	}
+
+	BuildWindow(type, table, size);
+	this->windows[key] = table;
+
+	return 0;
+}
+
+// Look up a window table, building it first if necessary
+const Sample* AudioProcessor::GetWindow(WindowType type, int size)
+{
+	std::map<std::pair<int, int>, Sample*>::iterator it = this->windows.find(std::make_pair((int)type, size));
+	if (it != this->windows.end()) {
+		return it->second;
+	}
+
+	if (this->PrepareWindow(type, size) != 0) {
+		return NULL;
+	}
+
+	return this->windows[std::make_pair((int)type, size)];
+}
+
+// Fast Fourier Transform method for converting a raw audio	data to the frequency domain. Writes
+// the magnitude (or power) of the fftsize/2+1 bins an r2c transform produces into the caller's
+// buffer. If a window table is given, it is applied while copying the data into the plan's input
+// buffer, so the samples are only touched once. Returns -1 if PrepareFFT wasn't called for the size.
+int AudioProcessor::PerformFFT(const Sample* data, int fftsize, Sample* spectrum, const Sample* window,
+							SpectrumScale scale, SampleComplex* transform)
+{
+	FFTPlan* entry = NULL;
+	Sample* in = (Sample*)data;	// r2c plans preserve their input
+
+	// without a window, look for a plan matching the input's alignment so the transform can run
+	// directly on the data
+	if (window == NULL) {
+		entry = this->FindPlan(fftsize, FFTW(alignment_of)((Sample*)data));
+	}
+
+	if (entry == NULL) {
+		// otherwise fall back on the aligned plan and copy the input into its buffer
+		// (planning here isn't safe: the FFTW planner isn't thread-safe, and this runs on the audio
+		// or a worker thread, so a size nobody prepared is an error)
+		entry = this->FindPlan(fftsize, FFT_DEFAULT_ALIGNMENT);
+		if (entry == NULL) {
+			return -1;
+		}
+
+		// copy (and window) the input into the plan's aligned buffer
+		if (window != NULL) {
+			ApplyWindow(data, window, entry->in, fftsize);
+		}
+		else {
+			memcpy(entry->in, data, sizeof(Sample) * fftsize);
+		}
+		in = entry->in;
+	}
+
+	// execute the cached plan on the (possibly new) input array
+	SampleComplex* out = entry->out;
+	FFTW(execute_dft_r2c)(entry->plan, in, out);
+
+	// Calculate the magnitude of the spectrum data (only the non-redundant half exists)
+	ComputeSpectrum(out, fftsize / 2 + 1, spectrum, scale);
+
+	// hand out the complex bins too, if asked (e.g. for their phases)
+	if (transform != NULL) {
+		memcpy(transform, out, sizeof(SampleComplex) * (fftsize / 2 + 1));
+	}
+
+	return 0;
+}
+
+// Build (or reuse) the plans for autocorrelating 'frames' samples. Like PrepareFFT, this should be
+// called before the audio stream is started.
+int AudioProcessor::PrepareAutocorrelation(int frames, unsigned int flags)
+{
+	if (frames <= 0) {
+		return -1;
+	}
+	if (this->acfPlans.find(frames) != this->acfPlans.end()) {
+		return 0;
+	}
+
+	// zero-pad to at least twice the length, so the circular correlation equals the linear one
+	ACFPlan entry;
+	entry.frames = frames;
+	entry.fftsize = 1;
+	while (entry.fftsize < 2 * frames) {
+		entry.fftsize <<= 1;
+	}
+
+	entry.in = (Sample*)FFTW(malloc)(sizeof(Sample) * entry.fftsize);
+	entry.spectrum = (SampleComplex*)FFTW(malloc)(sizeof(SampleComplex) * (entry.fftsize / 2 + 1));
+	entry.windowed = (SampleComplex*)FFTW(malloc)(sizeof(SampleComplex) * (frames / 2 + 1));
+	entry.out = (Sample*)FFTW(malloc)(sizeof(Sample) * entry.fftsize);
+	if (entry.in != NULL && entry.spectrum != NULL && entry.windowed != NULL && entry.out != NULL) {
+		entry.forward = this->MakePlan(false, entry.fftsize, entry.in, entry.spectrum, flags);
+		entry.inverse = this->MakePlan(true, entry.fftsize, entry.out, entry.spectrum, flags);
+	}
+
+	if (entry.forward == NULL || entry.inverse == NULL) {
+		if (entry.forward != NULL) FFTW(destroy_plan)(entry.forward);
+		if (entry.inverse != NULL) FFTW(destroy_plan)(entry.inverse);
+		FFTW(free)(entry.in);
+		FFTW(free)(entry.spectrum);
+		FFTW(free)(entry.windowed);
+		FFTW(free)(entry.out);
+		return -1;
+	}
+
+	memset(entry.in, 0, sizeof(Sample) * entry.fftsize);
+	this->acfPlans[frames] = entry;
+
+	return 0;
+}
+
+// Autocorrelation r(lag) = sum_j x[j] * x[j + lag] for lag = 0 .. lags-1, computed in O(N log N)
+// via the Wiener-Khinchin theorem: zero-padded forward FFT, power spectrum, inverse FFT.
+int AudioProcessor::Autocorrelate(const Sample* data, int frames, Sample* acf, int lags)
+{
+	std::map<int, ACFPlan>::iterator it = this->acfPlans.find(frames);
+	if (it == this->acfPlans.end() || lags > frames) {
+		return -1;
+	}
+	ACFPlan& entry = it->second;
+
+	// the tail of the input buffer stays zero from preparation
+	memcpy(entry.in, data, sizeof(Sample) * frames);
+	FFTW(execute_dft_r2c)(entry.forward, entry.in, entry.spectrum);
+
+	// |X|^2, as a (real) complex spectrum
+	int bins = entry.fftsize / 2 + 1;
+	for (int i = 0; i < bins; i += 1) {
+		double re = entry.spectrum[i][0];
+		double im = entry.spectrum[i][1];
+		entry.spectrum[i][0] = (Sample)(re*re + im*im);
+		entry.spectrum[i][1] = 0.0;
+	}
+
+	// back to the lag domain (FFTW's inverse is unnormalised)
+	FFTW(execute_dft_c2r)(entry.inverse, entry.spectrum, entry.out);
+	double scale = 1.0 / entry.fftsize;
+	for (int i = 0; i < lags; i += 1) {
+		acf[i] = (Sample)(entry.out[i] * scale);
+	}
+
+	return 0;
+}
+
+// Compute both the windowed spectrum of 'frames' samples and their (unwindowed) autocorrelation from
+// a single forward transform, so a time-domain estimator only adds one inverse FFT per frame. The
+// zero-padded 2N-point transform's even bins are exactly the N-point DFT, and cosine-sum windows
+// (Hann, Hamming, Blackman-Harris) are applied to those in the frequency domain, in their periodic
+// form. Returns -1 (without touching the outputs) for a Kaiser window or an unprepared size.
+int AudioProcessor::PerformFFTAndAutocorrelation(const Sample* data, int frames, Sample* spectrum, WindowType window,
+												Sample* acf, int lags, SpectrumScale scale, SampleComplex* transform)
+{
+	// cosine-sum coefficients: w[n] = a0 - a1 cos(2 pi n / N) + a2 cos(4 pi n / N) - ...
+	double coefficients[4] = { 0.0, 0.0, 0.0, 0.0 };
+	int taps;
+	switch (window) {
+	case WINDOW_HANN:
+		coefficients[0] = 0.5;
+		coefficients[1] = 0.5;
+		taps = 2;
+		break;
+	case WINDOW_HAMMING:
+		coefficients[0] = 0.54;
+		coefficients[1] = 0.46;
+		taps = 2;
+		break;
+	case WINDOW_BLACKMAN_HARRIS:
+		coefficients[0] = 0.35875;
+		coefficients[1] = 0.48829;
+		coefficients[2] = 0.14128;
+		coefficients[3] = 0.01168;
+		taps = 4;
+		break;
+	default:
+		return -1;
+	}
+
+	std::map<int, ACFPlan>::iterator it = this->acfPlans.find(frames);
+	if (it == this->acfPlans.end() || it->second.fftsize != 2 * frames || lags > frames) {
+		return -1;
+	}
+	ACFPlan& entry = it->second;
+
+	memcpy(entry.in, data, sizeof(Sample) * frames);
+	FFTW(execute_dft_r2c)(entry.forward, entry.in, entry.spectrum);
+
+	// window by convolving the N-point spectrum X[k] = padded[2k] with the window's few non-zero
+	// DFT taps; X[-m] and X[N/2 + m] are the conjugates of X[m] and X[N/2 - m]
+	int bins = frames / 2 + 1;
+	for (int k = 0; k < bins; k += 1) {
+		double re = coefficients[0] * entry.spectrum[2 * k][0];
+		double im = coefficients[0] * entry.spectrum[2 * k][1];
+
+		for (int j = 1; j < taps; j += 1) {
+			double weight = ((j & 1) ? -0.5 : 0.5) * coefficients[j];
+			int lower = k - j;
+			int upper = k + j;
+			double sign = 1.0;
+
+			if (lower < 0) {
+				lower = -lower;
+				sign = -1.0;
+			}
+			re += weight * entry.spectrum[2 * lower][0];
+			im += weight * sign * entry.spectrum[2 * lower][1];
+
+			sign = 1.0;
+			if (upper > frames / 2) {
+				upper = frames - upper;
+				sign = -1.0;
+			}
+			re += weight * entry.spectrum[2 * upper][0];
+			im += weight * sign * entry.spectrum[2 * upper][1];
+		}
+
+		entry.windowed[k][0] = (Sample)re;
+		entry.windowed[k][1] = (Sample)im;
+	}
+	ComputeSpectrum(entry.windowed, bins, spectrum, scale);
+	if (transform != NULL) {
+		memcpy(transform, entry.windowed, sizeof(SampleComplex) * bins);
+	}
+
+	// the autocorrelation is the inverse transform of the (padded) power spectrum
+	int padded = entry.fftsize / 2 + 1;
+	for (int i = 0; i < padded; i += 1) {
+		double re = entry.spectrum[i][0];
+		double im = entry.spectrum[i][1];
+		entry.spectrum[i][0] = (Sample)(re*re + im*im);
+		entry.spectrum[i][1] = 0.0;
+	}
+
+	FFTW(execute_dft_c2r)(entry.inverse, entry.spectrum, entry.out);
+	double norm = 1.0 / entry.fftsize;
+	for (int i = 0; i < lags; i += 1) {
+		acf[i] = (Sample)(entry.out[i] * norm);
 	}
 
-	// clean up and return
-	fftw_free(out);
-	return spectrum;
+	return 0;
 }
 
-// Harmonic Product Spectrum algorithm for pitch (fundamental frequency) estimation
-int AudioProcessor::HPS(std::vector<double> spectrum, int downsampleFactor) 
+// Harmonic Product Spectrum algorithm for pitch (fundamental frequency) estimation. The scratch
+// buffer must hold at least 'size' values. If requested, the confidence is the share of the
+// searched HPS energy that falls in the chosen bin.
+int AudioProcessor::HPS(const double* spectrum, int size, int downsampleFactor, double* scratch, double* confidence) 
 {
 	//*** downsample factor is the number of times to divide the signal before multiplying out
 
 	// limit the search range based on the downsample factor
-	int maxI = spectrum.size() / downsampleFactor;
+	int maxI = std::min(size / downsampleFactor, size - 1);
 	int bin = 1;
-	std::vector<double> hps(spectrum);
+	double total = 0.0;
+	double* hps = scratch;
+	memcpy(hps, spectrum, sizeof(double) * size);
 	for (int j = 1; j <= maxI; j += 1) {
 		// downsample and multiply
 		for (int i = 1; i <= downsampleFactor; i += 1) {
-			hps.at(j) *= spectrum.at(j*i-1);
+			hps[j] *= spectrum[j*i-1];
 		}
+		total += hps[j];
 
 		// Determine the highest possible target bin
-		if (hps.at(j) > hps.at(bin)) {
+		if (hps[j] > hps[bin]) {
 			bin = j;
 		}
 	}
@@ -64,17 +448,112 @@ int AudioProcessor::HPS(std::vector<double> spectrum, int downsampleFactor)
 	int max = bin * 3 / 4;
 	
 	for (int i = 2; i < max; i += 1) {
-		if (hps.at(i) > hps.at(fixBin)) {
+		if (hps[i] > hps[fixBin]) {
 			fixBin = i;
 		}
 	}
 
 	if (abs(fixBin * 2 - bin) < 4) {
-		if (hps.at(fixBin) / hps.at(bin) > 0.2) {
+		if (hps[fixBin] / hps[bin] > HPS_OCTAVE_RATIO) {
 			bin = fixBin;
 		}
 	}
 
+	if (confidence != NULL) {
+		*confidence = (total > 0.0) ? (hps[bin] / total) : 0.0;
+	}
+
+	// return the bin number containing the likely fundamental
+	return bin;
+}
+
+// Harmonic Product Spectrum in the log domain: with log10-magnitudes as input, the product of the
+// harmonics becomes a sum, which can neither underflow nor overflow however many harmonics are
+// used. Each harmonic is first decimated into a contiguous array so that the accumulation is a
+// straight vector add. The scratch buffer must hold at least 2 * 'size' values.
+int AudioProcessor::LogHPS(const Sample* logspectrum, int size, int harmonics, Sample* scratch, double* confidence)
+{
+	if (harmonics < 1 || size < 2 * harmonics) {
+		return 1;
+	}
+
+	// candidate bins j such that every harmonic j*h is still inside the spectrum
+	int count = (size - 1) / harmonics + 1;
+	Sample* hps = scratch;
+	Sample* decimated = scratch + size;
+
+	// the first harmonic is the spectrum itself
+	memcpy(hps, logspectrum, sizeof(Sample) * count);
+
+	for (int h = 2; h <= harmonics; h += 1) {
+		// downsample: gather every h-th bin. A fundamental anywhere within bin j puts its h-th
+		// harmonic within h/2 bins of j*h, so take the strongest of those; sampling j*h alone lets an
+		// off-centre fundamental's upper harmonics fall into the window's skirt, and the octave
+		// above (whose harmonics land nearer bin centres) win
+		int half = h / 2;
+		for (int j = 0; j < count; j += 1) {
+			int first = std::max(0, j * h - half);
+			int last = std::min(size - 1, j * h + half);
+			Sample strongest = logspectrum[first];
+			for (int k = first + 1; k <= last; k += 1) {
+				strongest = std::max(strongest, logspectrum[k]);
+			}
+			decimated[j] = strongest;
+		}
+
+		// and "multiply" (add the logs)
+		int j = 0;
+#ifdef SIMD_HAVE_SSE2
+		static const bool sse2 = SimdHasSSE2();
+		if (sse2) {
+			for (; j + 2 * SAMPLE_LANES <= count; j += 2 * SAMPLE_LANES) {
+				SampleStore(&hps[j], SampleAdd(SampleLoad(&hps[j]), SampleLoad(&decimated[j])));
+				SampleStore(&hps[j + SAMPLE_LANES], SampleAdd(SampleLoad(&hps[j + SAMPLE_LANES]), SampleLoad(&decimated[j + SAMPLE_LANES])));
+			}
+		}
+#endif
+		for (; j < count; j += 1) {
+			hps[j] += decimated[j];
+		}
+	}
+
+	// Determine the highest possible target bin
+	int bin = 1;
+	for (int j = 2; j < count; j += 1) {
+		if (hps[j] > hps[bin]) {
+			bin = j;
+		}
+	}
+
+	// attempt to fix octave misidentification errors (harmonics)
+	int fixBin = 1;
+	int max = bin * 3 / 4;
+
+	for (int i = 2; i < max; i += 1) {
+		if (hps[i] > hps[fixBin]) {
+			fixBin = i;
+		}
+	}
+
+	if (abs(fixBin * 2 - bin) < 4) {
+		if (hps[fixBin] - hps[bin] > log10(HPS_OCTAVE_RATIO)) {
+			bin = fixBin;
+		}
+	}
+
+	// confidence: the chosen bin's share of the (linear) HPS energy; bins more than six decades
+	// below it don't contribute measurably, so skip their exponentials
+	if (confidence != NULL) {
+		double total = 0.0;
+		for (int j = 1; j < count; j += 1) {
+			double diff = hps[j] - hps[bin];
+			if (diff > -6.0) {
+				total += pow(10.0, diff);
+			}
+		}
+		*confidence = (total > 0.0) ? (1.0 / total) : 0.0;
+	}
+
 	// return the bin number containing the likely fundamental
 	return bin;
 }
@@ -89,6 +568,311 @@ void AudioProcessor::ApplyWindowFunction(double* data, int size)
 }
 
 
+// Multiply the data by a precomputed window table, writing the result to 'out' (which may be the
+// same array as 'data')
+void AudioProcessor::ApplyWindow(const Sample* data, const Sample* window, Sample* out, int size)
+{
+	int i = 0;
+
+#ifdef SIMD_HAVE_SSE2
+	static const bool sse2 = SimdHasSSE2();
+	if (sse2) {
+		for (; i + 2 * SAMPLE_LANES <= size; i += 2 * SAMPLE_LANES) {
+			SampleVector d0 = SampleLoad(&data[i]);
+			SampleVector d1 = SampleLoad(&data[i + SAMPLE_LANES]);
+			SampleVector w0 = SampleLoad(&window[i]);
+			SampleVector w1 = SampleLoad(&window[i + SAMPLE_LANES]);
+			SampleStore(&out[i], SampleMul(d0, w0));
+			SampleStore(&out[i + SAMPLE_LANES], SampleMul(d1, w1));
+		}
+	}
+#endif
+
+	for (; i < size; i += 1) {
+		out[i] = data[i] * window[i];
+	}
+}
+
+// Convert complex FFT bins to magnitudes or powers
+void AudioProcessor::ComputeSpectrum(const SampleComplex* bins, int count, Sample* out, SpectrumScale scale)
+{
+	int i = 0;
+
+#ifdef SIMD_HAVE_SSE2
+	static const bool sse2 = SimdHasSSE2();
+	if (sse2) {
+		const Sample* in = (const Sample*)bins;
+#ifdef ANALYSIS_FLOAT32
+		for (; i + 4 <= count; i += 4) {
+			// four bins at a time: square them, then gather and add the re^2 and im^2 lanes
+			__m128 c0 = _mm_loadu_ps(&in[2 * i]);
+			__m128 c1 = _mm_loadu_ps(&in[2 * i + 4]);
+			c0 = _mm_mul_ps(c0, c0);
+			c1 = _mm_mul_ps(c1, c1);
+			__m128 power = _mm_add_ps(_mm_shuffle_ps(c0, c1, _MM_SHUFFLE(2, 0, 2, 0)),
+									_mm_shuffle_ps(c0, c1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+			if (scale == SPECTRUM_MAGNITUDE) {
+				power = _mm_sqrt_ps(power);
+			}
+			_mm_storeu_ps(&out[i], power);
+		}
+#else
+		for (; i + 2 <= count; i += 2) {
+			// two bins at a time: square both, then add re^2 + im^2 pairwise
+			__m128d c0 = _mm_loadu_pd(&in[2 * i]);
+			__m128d c1 = _mm_loadu_pd(&in[2 * i + 2]);
+			c0 = _mm_mul_pd(c0, c0);
+			c1 = _mm_mul_pd(c1, c1);
+			__m128d power = _mm_add_pd(_mm_unpacklo_pd(c0, c1), _mm_unpackhi_pd(c0, c1));
+
+			if (scale == SPECTRUM_MAGNITUDE) {
+				power = _mm_sqrt_pd(power);
+			}
+			_mm_storeu_pd(&out[i], power);
+		}
+#endif
+	}
+#endif
+
+	for (; i < count; i += 1) {
+		double re = bins[i][0];
+		double im = bins[i][1];
+		double power = re*re + im*im;
+		out[i] = (Sample)((scale == SPECTRUM_MAGNITUDE) ? sqrt(power) : power);
+	}
+}
+
+// Convert a spectrum to a logarithmic scale: out = scale * log10(in). Uses the fast approximation,
+// which is plenty for display and peak picking.
+void AudioProcessor::LogSpectrum(const Sample* in, Sample* out, int count, double scale)
+{
+	for (int i = 0; i < count; i += 1) {
+		out[i] = (Sample)(scale * FastLog10(in[i]));
+	}
+}
+
+// Approximate log10, accurate to ~1e-8, without calling into the C runtime. The exponent comes
+// straight from the IEEE-754 bits and the mantissa's log from a short atanh series.
+double AudioProcessor::FastLog10(double x)
+{
+	if (!(x >= 1e-30)) {
+		return LOG10_FLOOR;	// zero, tiny, negative or NaN
+	}
+
+	unsigned long long bits;
+	memcpy(&bits, &x, sizeof(bits));
+	int exponent = (int)((bits >> 52) & 0x7ff) - 1023;
+	bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+
+	double m;
+	memcpy(&m, &bits, sizeof(m));
+
+	// centre the mantissa on 1 so the series converges quickly: m in [sqrt(1/2), sqrt(2))
+	if (m > M_SQRT2) {
+		m *= 0.5;
+		exponent += 1;
+	}
+
+	// ln(m) = 2 * atanh(t), t = (m - 1) / (m + 1)
+	double t = (m - 1.0) / (m + 1.0);
+	double t2 = t * t;
+	double ln = 2.0 * t * (1.0 + t2 * (1.0 / 3 + t2 * (1.0 / 5 + t2 * (1.0 / 7 + t2 * (1.0 / 9)))));
+
+	return (exponent * M_LN2 + ln) * M_LOG10E;
+}
+
+// Refine the position of a spectral peak between bins: the vertex of the parabola through the peak
+// and its neighbours. On a log spectrum this is Gaussian interpolation, which is close to exact for
+// the main lobe of a Hann-windowed sinusoid.
+double AudioProcessor::InterpolatePeak(const Sample* values, int count, int peak)
+{
+	if (peak <= 0 || peak >= count - 1) {
+		return (double)peak;
+	}
+
+	double left = values[peak - 1];
+	double centre = values[peak];
+	double right = values[peak + 1];
+	double denominator = left - 2.0 * centre + right;
+	if (denominator >= 0.0) {
+		return (double)peak;	// not a maximum
+	}
+
+	double offset = 0.5 * (left - right) / denominator;
+	return peak + std::max(-0.5, std::min(0.5, offset));
+}
+
+// Phase vocoder frequency estimate, in (fractional) bins, for the sinusoid nearest 'bin': the phase
+// it gained over one hop, beyond the bin centre's expected advance, gives its offset from the
+// centre. 'current' and 'previous' are transforms taken 'hop' samples apart; offsets are
+// unambiguous up to fftsize / (2 * hop) bins either side.
+double AudioProcessor::PhaseVocoderBin(const SampleComplex* current, const SampleComplex* previous, int bin,
+									int fftsize, int hop)
+{
+	double phase = atan2(current[bin][1], current[bin][0]);
+	double previousPhase = atan2(previous[bin][1], previous[bin][0]);
+
+	// deviation from the expected advance, wrapped into -pi .. pi
+	double expected = 2.0 * M_PI * bin * hop / fftsize;
+	double deviation = phase - previousPhase - expected;
+	deviation -= 2.0 * M_PI * floor(deviation / (2.0 * M_PI) + 0.5);
+
+	return bin + deviation * fftsize / (2.0 * M_PI * hop);
+}
+
+// Run a bank of Goertzel resonators over 'count' samples. Each detector d has the coefficient
+// 2 * cos(w_d) and carries its last two states in s1[d] and s2[d] (zero them to start a new block),
+// from which its DFT term at w_d follows. The states are kept in double precision whatever the
+// sample type, since the recurrence loses accuracy at low frequencies over long blocks.
+void AudioProcessor::Goertzel(const Sample* data, int count, const double* coefficients, int detectors,
+							double* s1, double* s2)
+{
+	int d = 0;
+
+#ifdef SIMD_HAVE_SSE2
+	static const bool sse2 = SimdHasSSE2();
+	if (sse2) {
+		// two detectors per register, their states held in registers for the whole block; four at
+		// a time, so that two independent recurrences hide each other's latency
+		for (; d + 4 <= detectors; d += 4) {
+			__m128d ca = _mm_loadu_pd(&coefficients[d]);
+			__m128d cb = _mm_loadu_pd(&coefficients[d + 2]);
+			__m128d a1 = _mm_loadu_pd(&s1[d]);
+			__m128d a2 = _mm_loadu_pd(&s2[d]);
+			__m128d b1 = _mm_loadu_pd(&s1[d + 2]);
+			__m128d b2 = _mm_loadu_pd(&s2[d + 2]);
+			for (int i = 0; i < count; i += 1) {
+				__m128d x = _mm_set1_pd(data[i]);
+				__m128d a0 = _mm_sub_pd(_mm_add_pd(x, _mm_mul_pd(ca, a1)), a2);
+				__m128d b0 = _mm_sub_pd(_mm_add_pd(x, _mm_mul_pd(cb, b1)), b2);
+				a2 = a1;
+				a1 = a0;
+				b2 = b1;
+				b1 = b0;
+			}
+			_mm_storeu_pd(&s1[d], a1);
+			_mm_storeu_pd(&s2[d], a2);
+			_mm_storeu_pd(&s1[d + 2], b1);
+			_mm_storeu_pd(&s2[d + 2], b2);
+		}
+		for (; d + 2 <= detectors; d += 2) {
+			__m128d c = _mm_loadu_pd(&coefficients[d]);
+			__m128d p1 = _mm_loadu_pd(&s1[d]);
+			__m128d p2 = _mm_loadu_pd(&s2[d]);
+			for (int i = 0; i < count; i += 1) {
+				__m128d s0 = _mm_sub_pd(_mm_add_pd(_mm_set1_pd(data[i]), _mm_mul_pd(c, p1)), p2);
+				p2 = p1;
+				p1 = s0;
+			}
+			_mm_storeu_pd(&s1[d], p1);
+			_mm_storeu_pd(&s2[d], p2);
+		}
+	}
+#endif
+
+	for (; d < detectors; d += 1) {
+		double c = coefficients[d];
+		double p1 = s1[d];
+		double p2 = s2[d];
+		for (int i = 0; i < count; i += 1) {
+			double s0 = data[i] + c * p1 - p2;
+			p2 = p1;
+			p1 = s0;
+		}
+		s1[d] = p1;
+		s2[d] = p2;
+	}
+}
+
+// Fill a table with the requested (symmetric) window function
+void AudioProcessor::BuildWindow(WindowType type, Sample* table, int size)
+{
+	double n = size - 1.0;
+
+	for (int i = 0; i < size; i += 1) {
+		double x = 2 * M_PI * i / n;
+
+		switch (type) {
+		case WINDOW_HAMMING:
+			table[i] = (Sample)(0.54 - 0.46 * cos(x));
+			break;
+		case WINDOW_BLACKMAN_HARRIS:
+			table[i] = (Sample)(0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x));
+			break;
+		case WINDOW_KAISER: {
+			double r = 2.0 * i / n - 1.0;
+			table[i] = (Sample)(BesselI0(WINDOW_KAISER_BETA * sqrt(1.0 - r * r)) / BesselI0(WINDOW_KAISER_BETA));
+			break;
+		}
+		case WINDOW_HANN:
+		default:
+			table[i] = (Sample)(0.5 * (1 - cos(x)));
+			break;
+		}
+	}
+}
+
+// Number of taps (and the Kaiser beta) a windowed-sinc low-pass needs to fall from 'passband' to
+// 'stopband' Hz with the given stopband attenuation in dB (Kaiser's design formulas)
+int AudioProcessor::KaiserFIRLength(double samplerate, double passband, double stopband, double attenuation, double* beta)
+{
+	if (attenuation > 50.0) {
+		*beta = 0.1102 * (attenuation - 8.7);
+	}
+	else if (attenuation > 21.0) {
+		*beta = 0.5842 * pow(attenuation - 21.0, 0.4) + 0.07886 * (attenuation - 21.0);
+	}
+	else {
+		*beta = 0.0;
+	}
+
+	double transition = 2.0 * M_PI * (stopband - passband) / samplerate;
+	if (transition <= 0.0) {
+		return -1;
+	}
+
+	return (int)ceil((attenuation - 8.0) / (2.285 * transition)) + 1;
+}
+
+// Kaiser-windowed sinc low-pass with its -6 dB point at 'cutoff' Hz, normalised to unity DC gain
+void AudioProcessor::DesignLowPassFIR(Sample* taps, int count, double samplerate, double cutoff, double beta)
+{
+	double fc = cutoff / samplerate;
+	double centre = (count - 1) / 2.0;
+	double sum = 0.0;
+
+	for (int i = 0; i < count; i += 1) {
+		double t = i - centre;
+		double sinc = (t == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+		double r = (count > 1) ? t / centre : 0.0;
+		double tap = sinc * BesselI0(beta * sqrt(std::max(0.0, 1.0 - r * r))) / BesselI0(beta);
+		taps[i] = (Sample)tap;
+		sum += tap;
+	}
+
+	for (int i = 0; i < count; i += 1) {
+		taps[i] = (Sample)(taps[i] / sum);
+	}
+}
+
+// Zeroth-order modified Bessel function of the first kind (power series), for the Kaiser window
+double AudioProcessor::BesselI0(double x)
+{
+	double sum = 1.0, term = 1.0, half = x / 2.0;
+
+	for (int k = 1; k < 50; k += 1) {
+		term *= (half / k) * (half / k);
+		sum += term;
+		if (term < sum * 1e-16) {
+			break;
+		}
+	}
+
+	return sum;
+}
+
+
 // ***NOTE***
 // The following two Low-Pass Filter methods were written by Bjorn Roche and are used here with 
 // absolutely no claim of credit.
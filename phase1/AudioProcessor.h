@@ -18,18 +18,130 @@
 #include <complex>
 #include <cstring>
 #include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
 #include <math.h>
 
 // Local includes:
-#include "FFTW\fftw3.h"
+#include "SampleFormat.h"
+
+// Constants:
+#define FFT_DEFAULT_ALIGNMENT 0			// alignment offset of fftw_malloc'd buffers (as reported by fftw_alignment_of)
+#define WINDOW_KAISER_BETA 8.6			// shape parameter of the Kaiser window (~Blackman-like sidelobes)
+#define LOG10_FLOOR -30.0				// FastLog10 result for zero/tiny inputs (instead of -inf)
+#define HPS_OCTAVE_RATIO 0.2			// how strong the sub-octave peak must be (relative) to be preferred
+
+// Supported window functions
+enum WindowType
+{
+	WINDOW_HANN,
+	WINDOW_HAMMING,
+	WINDOW_BLACKMAN_HARRIS,
+	WINDOW_KAISER
+};
+
+// Output scales for spectrum kernels
+enum SpectrumScale
+{
+	SPECTRUM_MAGNITUDE,		// |X|
+	SPECTRUM_POWER			// |X|^2 (no square root)
+};
+
+// A cached FFTW plan, along with the aligned work buffers it was planned against
+struct FFTPlan
+{
+	int				size;
+	int				alignment;
+	Sample*			in;
+	SampleComplex*	out;
+	SamplePlan		plan;
+
+	FFTPlan() {
+		size = 0;
+		alignment = FFT_DEFAULT_ALIGNMENT;
+		in = NULL;
+		out = NULL;
+		plan = NULL;
+	}
+};
+
+// Cached FFTW plans and buffers for computing an autocorrelation (forward r2c, inverse c2r)
+struct ACFPlan
+{
+	int				frames;		// input length
+	int				fftsize;	// zero-padded transform length (>= 2 * frames, so lags don't wrap)
+	Sample*			in;
+	SampleComplex*	spectrum;
+	SampleComplex*	windowed;	// frequency-domain windowed spectrum (frames / 2 + 1 bins)
+	Sample*			out;
+	SamplePlan		forward;
+	SamplePlan		inverse;
+
+	ACFPlan() {
+		frames = 0;
+		fftsize = 0;
+		in = NULL;
+		spectrum = NULL;
+		windowed = NULL;
+		out = NULL;
+		forward = NULL;
+		inverse = NULL;
+	}
+};
 
 class AudioProcessor
 {
 public:
+	// Constructors/destructors:
+	AudioProcessor();
+	~AudioProcessor();
+
 	// Methods:
-	std::vector<double>	PerformFFT(double* data, int fftsize);
-	int					HPS(std::vector<double> spectrum, int harmonics);
+	int					PrepareFFT(int fftsize, unsigned int flags = FFTW_MEASURE, int alignment = FFT_DEFAULT_ALIGNMENT);
+	void				ClearPlans();
+	int					LoadWisdom(const std::string& path);
+	int					SaveWisdom(const std::string& path);
+	bool				HasNewWisdom() const { return newWisdom; }
+	int					PrepareWindow(WindowType type, int size);
+	const Sample*		GetWindow(WindowType type, int size);
+	int					PerformFFT(const Sample* data, int fftsize, Sample* spectrum, const Sample* window = NULL,
+								SpectrumScale scale = SPECTRUM_MAGNITUDE, SampleComplex* transform = NULL);
+	int					PrepareAutocorrelation(int frames, unsigned int flags = FFTW_MEASURE);
+	int					Autocorrelate(const Sample* data, int frames, Sample* acf, int lags);
+	int					PerformFFTAndAutocorrelation(const Sample* data, int frames, Sample* spectrum, WindowType window,
+													Sample* acf, int lags, SpectrumScale scale = SPECTRUM_MAGNITUDE,
+													SampleComplex* transform = NULL);
+	int					HPS(const double* spectrum, int size, int harmonics, double* scratch, double* confidence = NULL);
+	int					LogHPS(const Sample* logspectrum, int size, int harmonics, Sample* scratch, double* confidence = NULL);
 	static void			ApplyWindowFunction(double* data, int size);
+	static void			ApplyWindow(const Sample* data, const Sample* window, Sample* out, int size);
+	static void			ComputeSpectrum(const SampleComplex* bins, int count, Sample* out, SpectrumScale scale);
+	static void			LogSpectrum(const Sample* in, Sample* out, int count, double scale);
+	static double		FastLog10(double x);
+	static double		InterpolatePeak(const Sample* values, int count, int peak);
+	static double		PhaseVocoderBin(const SampleComplex* current, const SampleComplex* previous, int bin,
+										int fftsize, int hop);
+	static void			Goertzel(const Sample* data, int count, const double* coefficients, int detectors,
+								double* s1, double* s2);
+	static int			KaiserFIRLength(double samplerate, double passband, double stopband, double attenuation, double* beta);
+	static void			DesignLowPassFIR(Sample* taps, int count, double samplerate, double cutoff, double beta);
 	static void			CalcLowPassParams(double samplerate, double maxfrequency, double *a, double *b);
 	static double		LowPass(double x, double* mem, double* a, double* b);
+
+private:
+	// Private methods:
+	FFTPlan*			FindPlan(int fftsize, int alignment);
+	SamplePlan			MakePlan(bool inverse, int fftsize, Sample* real, SampleComplex* complex, unsigned int flags);
+	static void			BuildWindow(WindowType type, Sample* table, int size);
+	static double		BesselI0(double x);
+	// non-copyable (the plans and buffers are owned)
+	AudioProcessor(const AudioProcessor&);
+	AudioProcessor&		operator=(const AudioProcessor&);
+
+	// Private variables:
+	std::map<std::pair<int, int>, FFTPlan>	plans;		// FFTW plans, keyed by (size, alignment)
+	std::map<int, ACFPlan>					acfPlans;	// autocorrelation plans, keyed by input length
+	bool									newWisdom;	// set when a plan was measured since the last load/save
+	std::map<std::pair<int, int>, Sample*>	windows;	// window tables, keyed by (type, size)
 };
\ No newline at end of file
@@ -32,6 +32,10 @@ END_EVENT_TABLE()
 // ****** Constructor:
 AudioVisualizer::AudioVisualizer() : wxFrame((wxFrame *)NULL, -1, wxT("RT-Tuner"), wxDefaultPosition, wxSize(500, 500)) 
 {
+	// the default preset, until the capturer exists
+	this->settings = TunerPreset::GetSettings(TUNER_PRESET);
+	this->frequency = this->settings.minFrequency;
+
 	// Menus:
 	wxMenu *fileMenu = new wxMenu();
 
@@ -55,16 +59,25 @@ AudioVisualizer::AudioVisualizer() : wxFrame((wxFrame *)NULL, -1, wxT("RT-Tuner"
 	wxBoxSizer* spectrosizer = new wxBoxSizer(wxVERTICAL);
 
 	// ------ initialize the dataLayer vector
-	std::vector<double> spectrum;
-	std::vector<double> scale;
 	dataLayer = new mpFXYVector();
 	
-	for (size_t i = 0; i < AUDIO_BUFFER_FRAMES; i += 1) {
-		spectrum.push_back(0);
-		scale.push_back(i);
+	// (the constant-Q view's x axis is in MIDI notes, covering the range and its first few harmonics)
+	if (SPECTRUM_CONSTANT_Q) {
+		int lowest = (int)ceil(69.0 + 12.0 * log(this->settings.minFrequency / CQT_REFERENCE) / log(2.0));
+		int highest = (int)floor(69.0 + 12.0 * log(this->settings.maxFrequency * CQT_MAX_HARMONIC / CQT_REFERENCE) / log(2.0));
+		for (int i = lowest; i <= highest; i += 1) {
+			plotys.push_back(0);
+			plotxs.push_back(i);
+		}
+	}
+	else {
+		for (int i = 0; i < this->settings.frames / 2 + 1; i += 1) {
+			plotys.push_back(0);
+			plotxs.push_back(i);
+		}
 	}
 
-	dataLayer->SetData(scale, spectrum);
+	dataLayer->SetData(plotxs, plotys);
 	dataLayer->SetContinuity(true);
 	wxPen dataPen(*wxBLUE, 2, wxSOLID);
 	dataLayer->SetPen(dataPen);
@@ -72,7 +85,7 @@ AudioVisualizer::AudioVisualizer() : wxFrame((wxFrame *)NULL, -1, wxT("RT-Tuner"
 	
 	// ------ create and configure the graph
 	m_Plot = new mpWindow(spectropanel, -1, wxPoint(0, 0), wxSize(100, 100), wxSUNKEN_BORDER);
-	mpScaleX* xaxis = new mpScaleX(wxT("frequency"), mpALIGN_CENTER, TRUE, mpX_NORMAL);
+	mpScaleX* xaxis = new mpScaleX(SPECTRUM_CONSTANT_Q ? wxT("note (MIDI)") : wxT("frequency"), mpALIGN_CENTER, TRUE, mpX_NORMAL);
 	mpScaleY* yaxis = new mpScaleY(wxT("magnitude"), mpALIGN_CENTER, TRUE);
 	m_Plot->AddLayer(xaxis);
 	m_Plot->AddLayer(yaxis);
@@ -82,6 +95,32 @@ AudioVisualizer::AudioVisualizer() : wxFrame((wxFrame *)NULL, -1, wxT("RT-Tuner"
 	m_Plot->SetMPScrollbars(false);
 	m_Plot->Fit();
 
+	// ------ initialize the chroma vector and its graph (chroma only comes with the constant-Q view)
+	chromaLayer = NULL;
+	m_ChromaPlot = NULL;
+	if (SPECTRUM_CONSTANT_Q) {
+		chromaLayer = new mpFXYVector();
+
+		for (int i = 0; i < CHROMA_BINS; i += 1) {
+			chromays.push_back(0);
+			chromaxs.push_back(i);
+		}
+
+		chromaLayer->SetData(chromaxs, chromays);
+		chromaLayer->SetContinuity(true);
+		chromaLayer->SetPen(dataPen);
+		chromaLayer->SetDrawOutsideMargins(false);
+
+		m_ChromaPlot = new mpWindow(spectropanel, -1, wxPoint(0, 0), wxSize(100, 100), wxSUNKEN_BORDER);
+		m_ChromaPlot->AddLayer(new mpScaleX(wxT("pitch class (C = 0)"), mpALIGN_CENTER, TRUE, mpX_NORMAL));
+		m_ChromaPlot->AddLayer(new mpScaleY(wxT("energy"), mpALIGN_CENTER, TRUE));
+		m_ChromaPlot->AddLayer(chromaLayer);
+		m_ChromaPlot->EnableDoubleBuffer(true);
+		m_ChromaPlot->EnableMousePanZoom(false);
+		m_ChromaPlot->SetMPScrollbars(false);
+		m_ChromaPlot->Fit();
+	}
+
 	// ------ create the log window
 	m_Log = new wxTextCtrl(spectropanel, -1, wxT("---Program started---\n"), wxPoint(0, 0), wxSize(100, 100), wxTE_MULTILINE);
 	wxLog *old_log = wxLog::SetActiveTarget(new wxLogTextCtrl(m_Log));
@@ -89,6 +128,8 @@ AudioVisualizer::AudioVisualizer() : wxFrame((wxFrame *)NULL, -1, wxT("RT-Tuner"
 
 	// ------ (layout organization)
 	spectrosizer->Add(m_Plot, 1, wxALL | wxEXPAND, 5);
+	if (m_ChromaPlot != NULL)
+		spectrosizer->Add(m_ChromaPlot, 0, wxALL | wxEXPAND, 5);
 	spectrosizer->Add(m_Log, 0, wxALL | wxEXPAND, 5);
 
 	spectropanel->SetSizer(spectrosizer);
@@ -117,6 +158,23 @@ AudioVisualizer::AudioVisualizer() : wxFrame((wxFrame *)NULL, -1, wxT("RT-Tuner"
 	
 	notebook->AddPage(tunerpanel, wxT("Tuner"), false);
 
+	// ---- Diagnostics tab
+	diagnosticspanel = new wxPanel(notebook);
+	wxBoxSizer* diagnosticssizer = new wxBoxSizer(wxVERTICAL);
+
+	// ------ a fixed-width table of where the audio path's time goes
+	m_Diagnostics = new wxTextCtrl(diagnosticspanel, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY);
+	m_Diagnostics->SetFont(wxFont(9, wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL));
+
+	// ------ (layout organization)
+	diagnosticssizer->Add(m_Diagnostics, 1, wxALL | wxEXPAND, 5);
+
+	diagnosticspanel->SetSizer(diagnosticssizer);
+	diagnosticspanel->Layout();
+	diagnosticssizer->Fit(diagnosticspanel);
+
+	notebook->AddPage(diagnosticspanel, wxT("Diagnostics"), false);
+
 	windowsizer->Add(notebook, 1, wxEXPAND | wxALL, 5);
 
 	// -- Start/stop button
@@ -135,7 +193,7 @@ AudioVisualizer::AudioVisualizer() : wxFrame((wxFrame *)NULL, -1, wxT("RT-Tuner"
 	m_timer->Start(REFRESH_INTERVAL);
 
 	// initialize audio capturer
-	capturer = new AudioCapturer(this->dataLayer, &this->totalfreq, &this->freqcount);
+	capturer = new AudioCapturer();
 	this->running = true;	// indicate that the audio function is running
 
 }
@@ -152,7 +210,7 @@ void AudioVisualizer::SetUpAngularMeter(wxPanel* panel)
 	m_AngularMeter->SetNumTick(3);
 	
 	// define the scale
-	m_AngularMeter->SetRange(MIN_FREQ, MAX_FREQ);
+	m_AngularMeter->SetRange((int)this->settings.minFrequency, (int)this->settings.maxFrequency);
 	m_AngularMeter->SetAngle(-20, 200);
 	m_AngularMeter->SetValue(220);
 
@@ -223,7 +281,13 @@ void AudioVisualizer::WriteNote()
 void AudioVisualizer::RefreshWindow() 
 {
 	// When viewing the "Tuner" tab:
-	if (this->notebook->GetCurrentPage() == this->tunerpanel) {
+	if (this->notebook->GetCurrentPage() == this->tunerpanel && !this->signal) {
+		// nothing to tune: rest the needle
+		m_AngularMeter->SetValue((int)this->settings.minFrequency);
+		m_FreqText->SetLabelText("No signal");
+		m_NoteText->SetLabelText("");
+	}
+	else if (this->notebook->GetCurrentPage() == this->tunerpanel) {
 		// wait for at least five data points before determining a fundamental freq
 		if (freqcount > 4) {
 			this->frequency = (this->totalfreq / this->freqcount);
@@ -232,10 +296,10 @@ void AudioVisualizer::RefreshWindow()
 		}
 
 		// cap the frequency within the relevant range
-		if (this->frequency > MAX_FREQ)
-			m_AngularMeter->SetValue(MAX_FREQ);
-		else if (this->frequency < MIN_FREQ)
-			m_AngularMeter->SetValue(MIN_FREQ);
+		if (this->frequency > this->settings.maxFrequency)
+			m_AngularMeter->SetValue((int)this->settings.maxFrequency);
+		else if (this->frequency < this->settings.minFrequency)
+			m_AngularMeter->SetValue((int)this->settings.minFrequency);
 		else
 			m_AngularMeter->SetValue(this->frequency);
 
@@ -246,17 +310,133 @@ void AudioVisualizer::RefreshWindow()
 	} 
 	// When viewing the "Spectrum" tab:
 	else if (this->notebook->GetCurrentPage() == this->spectropanel) {
-		// update the graph
-		this->frequency = (this->totalfreq / this->freqcount);
-		this->m_Plot->Fit(-50,500,-50,30);
+		// update the graph (the average is empty while the gate is closed)
+		if (this->freqcount > 0)
+			this->frequency = (this->totalfreq / this->freqcount);
+		if (SPECTRUM_CONSTANT_Q && !this->plotxs.empty())
+			this->m_Plot->Fit(this->plotxs.front() - 1, this->plotxs.back() + 1, -50, 30);
+		else
+			this->m_Plot->Fit(-50,500,-50,30);
+		if (SPECTRUM_CONSTANT_Q)
+			this->m_ChromaPlot->Fit(-0.5, CHROMA_BINS - 0.5, 0, 1.1);
+	}
+	// When viewing the "Diagnostics" tab:
+	else if (this->notebook->GetCurrentPage() == this->diagnosticspanel) {
+		this->WriteDiagnostics();
 	}
 
-	if (running)
-		this->SetStatusText("Audio stream running...");
+	// with several channels, the status bar follows the others
+	if (running) {
+		wxString status = wxT("Audio stream running...");
+		for (size_t c = 1; c < this->channelFrequency.size(); c += 1) {
+			if (this->channelFrequency[c] > 0.0)
+				status += wxString::Format(wxT("   ch%d: %.1f Hz"), (int)c + 1, this->channelFrequency[c]);
+			else
+				status += wxString::Format(wxT("   ch%d: --"), (int)c + 1);
+		}
+		this->SetStatusText(status);
+	}
 	else
 		this->SetStatusText("Audio stream stopped.");
 }
 
+// Collect the analysis frames published by the audio thread since the last refresh
+void AudioVisualizer::DrainResults()
+{
+	AnalysisRing* results = this->capturer->GetResults();
+	const AnalysisFrame* frame;
+	bool received = false;
+
+	while ((frame = results->Front()) != NULL) {
+		// windows the silence gate skipped carry no estimate (or spectrum), and shouldn't drag the
+		// average down
+		this->signal = frame->signal;
+		if (!frame->signal) {
+			this->totalfreq = 0.0;
+			this->freqcount = 0;
+			results->PopFront();
+			continue;
+		}
+
+		// accumulate frequency data over time, so we can average the results
+		this->totalfreq += frame->fundamental;
+		this->freqcount += 1;
+
+		// keep the newest spectrum for the graph (target tuning doesn't compute one): a point per
+		// note, or a point per FFT bin
+		if (frame->bins == 0) {
+			results->PopFront();
+			continue;
+		}
+		if (SPECTRUM_CONSTANT_Q && frame->cqBins > 0) {
+			this->plotxs.resize(frame->cqBins);
+			this->plotys.resize(frame->cqBins);
+			for (int i = 0; i < frame->cqBins; i += 1) {
+				this->plotxs[i] = frame->cqNote + i * frame->cqStep;
+				this->plotys[i] = frame->constantQ[i];
+			}
+			for (int i = 0; i < CHROMA_BINS; i += 1) {
+				this->chromays[i] = frame->chroma[i];
+			}
+		}
+		else {
+			this->plotxs.resize(frame->bins);
+			this->plotys.resize(frame->bins);
+			for (int i = 0; i < frame->bins; i += 1) {
+				this->plotxs[i] = i;
+				this->plotys[i] = frame->spectrum[i];
+			}
+		}
+
+		results->PopFront();
+		received = true;
+	}
+
+	// the other channels' newest estimates (0 when silent)
+	int channels = this->capturer->GetChannels();
+	this->channelFrequency.resize(channels, 0.0);
+	for (int c = 1; c < channels; c += 1) {
+		AnalysisRing* ring = this->capturer->GetResults(c);
+		while ((frame = ring->Front()) != NULL) {
+			this->channelFrequency[c] = (frame->signal ? frame->fundamental : 0.0);
+			ring->PopFront();
+		}
+	}
+
+	// update the frequency spectrum graph
+	if (received) {
+		this->dataLayer->SetData(this->plotxs, this->plotys);
+		if (SPECTRUM_CONSTANT_Q)
+			this->chromaLayer->SetData(this->chromaxs, this->chromays);
+	}
+}
+
+// Show how long each stage of the audio path takes (mean, median, 99th percentile and worst case,
+// in microseconds), the callback's budget, and how often data has been lost
+void AudioVisualizer::WriteDiagnostics()
+{
+	StatsSnapshot snapshot;
+	if (this->capturer->GetStats(&snapshot) != 0) {
+		m_Diagnostics->ChangeValue(wxT("Stage timing is off (see AUDIO_STAGE_TIMING)."));
+		return;
+	}
+
+	wxString text = wxString::Format(wxT("%-14s %10s %9s %9s %9s %9s\n"), wxT("stage"), wxT("count"), wxT("mean us"),
+		wxT("p50 us"), wxT("p99 us"), wxT("max us"));
+	for (int s = 0; s < STAGE_COUNT; s += 1) {
+		StageSummary stage = snapshot.Summarize((TimedStage)s);
+		text += wxString::Format(wxT("%-14s %10llu %9.1f %9.1f %9.1f %9.1f\n"), StageStats::StageName((TimedStage)s),
+			stage.count, stage.mean / 1000.0, stage.p50 / 1000.0, stage.p99 / 1000.0, stage.max / 1000.0);
+	}
+
+	text += wxString::Format(wxT("\ndevice buffer (callback budget): %.0f us\n\n"), 1e6 * this->capturer->GetBufferSeconds());
+	for (int c = 0; c < COUNTER_COUNT; c += 1) {
+		text += wxString::Format(wxT("%-22s %llu\n"), StageStats::CounterName((StageCounter)c), snapshot.counters[c]);
+	}
+
+	m_Diagnostics->ChangeValue(text);
+}
+
 // Start the audio stream
 int AudioVisualizer::InitializeAudio() 
 {
@@ -268,6 +448,29 @@ int AudioVisualizer::InitializeAudio()
 	return 0;
 }
 
+// Choose the pitch estimator; call before InitializeAudio
+void AudioVisualizer::SetPitchMethod(PitchMethod method)
+{
+	this->capturer->SetPitchMethod(method);
+}
+
+// Choose how many input channels to capture (the graph and tuner follow the first); call before
+// InitializeAudio
+void AudioVisualizer::SetChannels(int channels)
+{
+	this->capturer->SetChannels(channels);
+}
+
+// Choose the instrument preset, rescaling the needle gauge to its note range; call before
+// InitializeAudio
+void AudioVisualizer::SetPreset(TunerPresetId preset)
+{
+	this->capturer->SetPreset(preset);
+	this->settings = this->capturer->GetSettings();
+	this->frequency = this->settings.minFrequency;
+	m_AngularMeter->SetRange((int)this->settings.minFrequency, (int)this->settings.maxFrequency);
+}
+
 // ****** Event handlers:
 //Handler for close via File -> Exit menu
 void AudioVisualizer::OnQuit(wxCommandEvent &WXUNUSED(event))
@@ -335,6 +538,7 @@ void AudioVisualizer::OnStartStopButton(wxCommandEvent& WXUNUSED(event))
 // Handler for timer
 void AudioVisualizer::OnRefreshTimer(wxTimerEvent& event)
 {
+	this->DrainResults();
 	this->RefreshWindow();
 }
 
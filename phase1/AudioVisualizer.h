@@ -55,7 +55,12 @@ public:
 	void	WriteNote();
 	void	FreqToNote(double freq);
 	void	RefreshWindow();
+	void	DrainResults();
+	void	WriteDiagnostics();
 	int		InitializeAudio();
+	void	SetPitchMethod(PitchMethod method);
+	void	SetPreset(TunerPresetId preset);
+	void	SetChannels(int channels);
 	// -- event handlers
 	void	OnQuit(wxCommandEvent &event);
 	void	OnClose(wxCloseEvent& event);
@@ -66,9 +71,17 @@ public:
 	// Public variables:
 	mpWindow*			m_Plot;				// graph window
 	mpFXYVector*		dataLayer;			// vector data for graph
+	mpWindow*			m_ChromaPlot;		// pitch class graph window (only with SPECTRUM_CONSTANT_Q)
+	mpFXYVector*		chromaLayer;		// vector data for the pitch class graph (only with SPECTRUM_CONSTANT_Q)
 
 	double				totalfreq = 0.0;	// used for calculating... 
 	int					freqcount = 0;		//			...average fundamental freq
+	bool				signal = false;		// whether the newest frame passed the silence gate
+	std::vector<double>	plotxs;				// spectrum graph data, refreshed from... 
+	std::vector<double>	plotys;				//			...the latest analysis frame
+	std::vector<double>	chromaxs;			// pitch class graph data (C = 0)
+	std::vector<double>	chromays;
+	std::vector<double>	channelFrequency;	// newest estimate of each channel after the first (0 when silent)
 
 private:
 	// Private variables:
@@ -76,16 +89,19 @@ private:
 	wxNotebook*			notebook;
 	wxPanel*			spectropanel;
 	wxPanel*			tunerpanel;
+	wxPanel*			diagnosticspanel;
 	wxButton*			startstopButton;
 	kwxAngularMeter*	m_AngularMeter;		// needle gauge
 	wxStaticText*		m_FreqText;			// label for displaying frequency
 	wxStaticText*		m_NoteText;			// label for displaying musical note info
 	wxTimer*			m_timer;
 	wxTextCtrl*			m_Log;				// log window for the graph
+	wxTextCtrl*			m_Diagnostics;		// stage timings and counters
 	
 	AudioCapturer*		capturer;
 	boolean				running;
-	double				frequency = MIN_FREQ;
+	TunerSettings		settings;			// the capturer's preset (note range, spectrum size)
+	double				frequency;			// the last average fundamental (starts at the bottom of the range)
 	int					cents;	
 	int					octave;				
 	std::string			note;
@@ -0,0 +1,247 @@
+/**
+* @file		BatchAnalyzer.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The BatchAnalyzer class runs recorded audio through the live tuner's
+* filter, window, FFT and pitch estimation chain, offline. Long files are cut
+* into chunks that a pool of threads analyses in parallel; each chunk starts a
+* little early, so its filters and estimator have settled by the time its own
+* windows begin, and the pitch track comes out as if it were one pass.
+**/
+
+#include "BatchAnalyzer.h"
+
+// Standard includes:
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+// ****** Constructors:
+BatchAnalyzer::BatchAnalyzer(TunerPresetId preset, PitchMethod method)
+{
+	this->preset = preset;
+	this->method = method;
+	this->settings = TunerPreset::GetSettings(preset);
+	this->threads = 0;
+	this->chunkSeconds = BATCH_CHUNK_SECONDS;
+	this->channel = AUDIO_FILE_MIX;
+	this->frames = 0;
+	this->hop = 0;
+	this->decimation = 1;
+	this->analysisRate = 0.0;
+	this->windows = 0;
+	this->chunkWindows = 0;
+}
+
+// ****** Methods:
+// Set the number of analysis threads (0 for one per core)
+void BatchAnalyzer::SetThreads(int threads)
+{
+	this->threads = std::max(0, threads);
+}
+
+// Set how much audio each thread takes at a time. Shorter chunks spread a short file over more
+// threads, but each one repeats the warm-up.
+void BatchAnalyzer::SetChunkSeconds(double seconds)
+{
+	this->chunkSeconds = seconds;
+}
+
+// Analyse one channel of the file (from 0), or the average of all of them (AUDIO_FILE_MIX)
+void BatchAnalyzer::SetChannel(int channel)
+{
+	this->channel = channel;
+}
+
+// Set the location of the FFTW wisdom store (an empty path disables it)
+void BatchAnalyzer::SetWisdomFile(const std::string& path)
+{
+	this->wisdomFile = path;
+}
+
+// Analyse a WAV file (or, with 'raw', headerless PCM) into a pitch track, one point per analysis
+// window, in order. The file is decimated to the preset's analysis rate just as the live tuner
+// decimates the device's native rate.
+int BatchAnalyzer::Analyze(const std::string& path, const AudioFileFormat* raw, std::vector<PitchPoint>* track,
+						BatchStats* stats)
+{
+	std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+	track->clear();
+
+	AudioFileReader source;
+	if (source.Open(path, raw) != 0) {
+		return -1;
+	}
+	AudioFileFormat format = source.GetFormat();
+	source.Close();
+	if (this->channel >= format.channels) {
+		std::cout << "***Problem: " << path << " only has " << format.channels << " channels.\n";
+		return -1;
+	}
+
+	// the same window and decimation as the live tuner, for the file's rate
+	TunerPreset::GetWindow(this->settings, this->method, &this->frames, &this->hop);
+	this->decimation = std::max(1, (format.sampleRate + this->settings.sampleRate / 2) / this->settings.sampleRate);
+	this->analysisRate = (double)format.sampleRate / this->decimation;
+
+	long long samples = format.frames / this->decimation;
+	this->windows = (samples >= this->frames) ? (samples - this->frames) / this->hop + 1 : 0;
+	this->chunkWindows = std::max(1, (int)(this->chunkSeconds * this->analysisRate / this->hop));
+	int chunks = (int)((this->windows + this->chunkWindows - 1) / this->chunkWindows);
+
+	int cores = std::max(1, (int)std::thread::hardware_concurrency());
+	int count = std::max(1, std::min((this->threads > 0) ? this->threads : cores, chunks));
+
+	// set every thread's pipeline up here, since FFTW's planner isn't thread-safe
+	this->ReleaseWorkers();
+	for (int i = 0; i < count; i += 1) {
+		Worker* worker = new Worker();
+		worker->processor = new AudioProcessor();
+		worker->context = new ProcessingContext(this->frames, this->hop);
+		worker->results = new AnalysisRing(ANALYSIS_RING_FRAMES);
+		worker->pipeline = new AnalysisPipeline(worker->processor, worker->context, worker->results, this->settings.sampleRate,
+												this->settings.minFrequency, this->settings.maxFrequency, ANALYSIS_WINDOW);
+		worker->estimator = TunerPreset::CreateEstimator(this->preset, this->method, PITCH_REFINEMENT);
+		worker->pipeline->SetEstimator(worker->estimator);
+		worker->pipeline->SetGate(AUDIO_USE_GATE);
+		worker->block.assign(BATCH_BLOCK_HOPS * this->hop * this->decimation, 0.0);
+		this->workers.push_back(worker);
+
+		if (i == 0) {
+			worker->processor->LoadWisdom(this->wisdomFile);
+		}
+		if (worker->pipeline->SetInputRate(format.sampleRate, this->decimation) != 0 ||
+			worker->pipeline->Prepare(FFT_PLANNER_FLAGS) != 0 || worker->reader.Open(path, &format) != 0) {
+			std::cout << "***Problem setting up the analysis of " << path << "\n";
+			this->ReleaseWorkers();
+			return -1;
+		}
+	}
+
+	// the threads take chunks in turn until none are left
+	std::vector<std::vector<PitchPoint> > points(chunks);
+	std::atomic<int> next(0);
+	std::atomic<int> failures(0);
+	std::vector<std::thread> pool;
+	for (int i = 0; i < count; i += 1) {
+		Worker* worker = this->workers[i];
+		pool.push_back(std::thread([this, worker, chunks, &points, &next, &failures]() {
+			for (int c = next++; c < chunks; c = next++) {
+				if (this->AnalyzeChunk(worker, c, &points[c]) != 0) {
+					failures += 1;
+				}
+			}
+		}));
+	}
+	for (int i = 0; i < count; i += 1) {
+		pool[i].join();
+	}
+	this->ReleaseWorkers();
+
+	if (failures > 0) {
+		std::cout << "***Problem reading " << path << "\n";
+		return -1;
+	}
+	for (int c = 0; c < chunks; c += 1) {
+		track->insert(track->end(), points[c].begin(), points[c].end());
+	}
+
+	if (stats != NULL) {
+		stats->duration = (double)format.frames / format.sampleRate;
+		stats->elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		stats->realtime = (stats->elapsed > 0.0) ? (stats->duration / stats->elapsed) : 0.0;
+		stats->windows = (int)track->size();
+		stats->chunks = chunks;
+		stats->threads = count;
+	}
+
+	return 0;
+}
+
+// Write a pitch track as CSV: time (s), frequency (Hz), confidence, level (dBFS) and whether the
+// window held a signal
+int BatchAnalyzer::WriteTrack(const std::vector<PitchPoint>& track, const std::string& path)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == NULL) {
+		std::cout << "***Problem writing " << path << "\n";
+		return -1;
+	}
+
+	fprintf(file, "time,frequency,confidence,level,signal\n");
+	for (size_t i = 0; i < track.size(); i += 1) {
+		const PitchPoint& point = track[i];
+		fprintf(file, "%.4f,%.3f,%.3f,%.1f,%d\n", point.time, point.frequency, point.confidence, point.level,
+				point.signal ? 1 : 0);
+	}
+
+	return (fclose(file) == 0) ? 0 : -1;
+}
+
+// Analyse one chunk's windows. The pipeline starts BATCH_WARMUP_WINDOWS windows (whole hops) early
+// with clean state, and the frames it publishes for the warm-up are thrown away; window k always
+// starts at analysis sample k * hop, so the chunk's frames line up with a single pass's.
+int BatchAnalyzer::AnalyzeChunk(Worker* worker, int chunk, std::vector<PitchPoint>* points)
+{
+	long long first = (long long)chunk * this->chunkWindows;
+	long long last = std::min(this->windows, first + this->chunkWindows);
+	long long warmup = (BATCH_WARMUP_WINDOWS * this->frames + this->hop - 1) / this->hop;
+	long long window = std::max(0LL, first - warmup);
+
+	// from the first warm-up window's start to the end of the chunk's last window (plus a sample, as
+	// the decimator may hold the final one back)
+	long long position = window * this->hop * this->decimation;
+	long long end = (((last - 1) * this->hop + this->frames) + 1) * this->decimation;
+	end = std::min(end, worker->reader.GetFormat().frames);
+
+	worker->pipeline->Reset();
+	if (worker->reader.Seek(position) != 0) {
+		return -1;
+	}
+
+	points->reserve((size_t)(last - first));
+	while (position < end && window < last) {
+		int wanted = (int)std::min((long long)worker->block.size(), end - position);
+		int got = worker->reader.Read(&worker->block[0], wanted, this->channel);
+		if (got <= 0) {
+			return -1;
+		}
+		worker->pipeline->PushSamples(&worker->block[0], got);
+		position += got;
+
+		// every window (analysed or gated) publishes exactly one frame
+		const AnalysisFrame* frame;
+		while ((frame = worker->results->Front()) != NULL) {
+			if (window >= first && window < last) {
+				PitchPoint point;
+				point.time = (window * this->hop + this->frames / 2) / this->analysisRate;
+				point.frequency = frame->fundamental;
+				point.confidence = frame->confidence;
+				point.level = frame->level;
+				point.signal = frame->signal;
+				points->push_back(point);
+			}
+			window += 1;
+			worker->results->PopFront();
+		}
+	}
+
+	return 0;
+}
+
+// Delete every thread's pipeline
+void BatchAnalyzer::ReleaseWorkers()
+{
+	for (size_t i = 0; i < this->workers.size(); i += 1) {
+		Worker* worker = this->workers[i];
+		delete worker->pipeline;
+		delete worker->estimator;
+		delete worker->context;
+		delete worker->results;
+		delete worker->processor;
+		delete worker;
+	}
+	this->workers.clear();
+}
\ No newline at end of file
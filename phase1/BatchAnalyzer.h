@@ -0,0 +1,108 @@
+/**
+* @file		BatchAnalyzer.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The BatchAnalyzer class runs recorded audio through the live tuner's
+* filter, window, FFT and pitch estimation chain, offline. Long files are cut
+* into chunks that a pool of threads analyses in parallel; each chunk starts a
+* little early, so its filters and estimator have settled by the time its own
+* windows begin, and the pitch track comes out as if it were one pass.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <string>
+#include <vector>
+
+// Local includes:
+#include "AnalysisConfig.h"
+#include "AnalysisPipeline.h"
+#include "AudioFileReader.h"
+
+// Constants:
+#define BATCH_CHUNK_SECONDS 60.0		// audio each thread takes at a time (default: 60)
+#define BATCH_WARMUP_WINDOWS 2			// windows of audio each chunk starts early by (default: 2)
+#define BATCH_BLOCK_HOPS 8				// hops of audio read from the file at a time (default: 8)
+
+// One point of a pitch track
+struct PitchPoint
+{
+	double	time;					// centre of the analysis window (s)
+	double	frequency;				// estimated fundamental frequency (Hz), 0 if none
+	double	confidence;				// confidence in the estimate, 0..1
+	double	level;					// RMS level of the window (dBFS)
+	bool	signal;					// false if the window was gated as silent
+};
+
+// What an analysis covered, and how long it took
+struct BatchStats
+{
+	double	duration;				// audio analysed (s)
+	double	elapsed;				// wall-clock time taken (s)
+	double	realtime;				// duration / elapsed
+	int		windows;				// analysis windows in the track
+	int		chunks;
+	int		threads;
+
+	BatchStats() {
+		duration = 0.0;
+		elapsed = 0.0;
+		realtime = 0.0;
+		windows = 0;
+		chunks = 0;
+		threads = 0;
+	}
+};
+
+class BatchAnalyzer
+{
+public:
+	// Constructors/destructors:
+	BatchAnalyzer(TunerPresetId preset = TUNER_PRESET, PitchMethod method = PITCH_METHOD);
+
+	// Methods:
+	void	SetThreads(int threads);
+	void	SetChunkSeconds(double seconds);
+	void	SetChannel(int channel);
+	void	SetWisdomFile(const std::string& path);
+	int		Analyze(const std::string& path, const AudioFileFormat* raw, std::vector<PitchPoint>* track,
+					BatchStats* stats);
+	static int	WriteTrack(const std::vector<PitchPoint>& track, const std::string& path);
+
+private:
+	// Everything one thread analyses with
+	struct Worker
+	{
+		AudioProcessor*		processor;
+		ProcessingContext*	context;
+		AnalysisRing*		results;
+		AnalysisPipeline*	pipeline;
+		PitchEstimator*		estimator;
+		AudioFileReader		reader;
+		std::vector<Sample>	block;		// samples read from the file, on their way into the pipeline
+	};
+
+	// Private methods:
+	int		AnalyzeChunk(Worker* worker, int chunk, std::vector<PitchPoint>* points);
+	void	ReleaseWorkers();
+
+	// Private variables:
+	TunerPresetId			preset;
+	PitchMethod				method;
+	TunerSettings			settings;
+	int						threads;		// 0 for one per core
+	double					chunkSeconds;
+	int						channel;		// the file's channel to analyse (AUDIO_FILE_MIX for all of them)
+	std::string				wisdomFile;
+	std::vector<Worker*>	workers;
+
+	// -- the current analysis
+	int						frames;			// analysis window
+	int						hop;			// analysis samples between windows
+	int						decimation;		// file samples per analysis sample
+	double					analysisRate;
+	long long				windows;		// windows in the file
+	int						chunkWindows;	// windows per chunk
+};
\ No newline at end of file
@@ -0,0 +1,175 @@
+/**
+* @file		ConstantQ.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The ConstantQ class turns the complex spectrum of an analysis window into a
+* constant-Q transform with one bin per semitone (Brown & Puckette's efficient
+* method: each bin is a short sparse dot product with a precomputed spectral
+* kernel), and reduces that to a 12-bin chroma vector.
+**/
+
+#include "ConstantQ.h"
+
+// ****** Constructors:
+ConstantQ::ConstantQ()
+{
+	fftSize = 0;
+	bins = 0;
+	lowest = 0;
+}
+
+// ****** Methods:
+// Build the spectral kernels for 'fftsize'-point transforms at the given rate, with a bin on every
+// note from 'minfrequency' up to 'maxfrequency'. Each bin's temporal kernel is a Hann-windowed
+// complex exponential Q cycles long, centred in the frame (and cut to the frame, for the lowest notes
+// of a short frame); its DFT is near zero away from the note, so only the run of FFT bins around the
+// note is kept. This allocates and is slow, so it must not be called from the audio thread.
+int ConstantQ::Prepare(int fftsize, double samplerate, double minfrequency, double maxfrequency)
+{
+	if (fftsize <= 0 || samplerate <= 0.0 || minfrequency <= 0.0) {
+		return -1;
+	}
+
+	// notes inside the range, stopping short of Nyquist
+	double q = 1.0 / (pow(2.0, 1.0 / CQT_BINS_PER_OCTAVE) - 1.0);
+	maxfrequency = std::min(maxfrequency, 0.5 * samplerate / pow(2.0, 1.0 / CQT_BINS_PER_OCTAVE));
+	int low = (int)ceil(CQT_BINS_PER_OCTAVE * log(minfrequency / CQT_REFERENCE) / log(2.0) - 1e-9);
+	int high = (int)floor(CQT_BINS_PER_OCTAVE * log(maxfrequency / CQT_REFERENCE) / log(2.0) + 1e-9);
+	if (high < low) {
+		return -1;
+	}
+
+	this->fftSize = fftsize;
+	this->lowest = low;
+	this->bins = high - low + 1;
+	this->first.assign(this->bins, 0);
+	this->offset.assign(this->bins + 1, 0);
+	this->real.clear();
+	this->imag.clear();
+
+	int last = fftsize / 2;
+	std::vector<double> kernelReal, kernelImag;
+	for (int k = 0; k < this->bins; k += 1) {
+		double frequency = this->GetFrequency(k);
+		int length = std::min(fftsize, (int)ceil(q * samplerate / frequency));
+		int start = (fftsize - length) / 2;
+		double omega = 2.0 * M_PI * frequency / samplerate;
+
+		// the main lobe spans two of the kernel's own bins either side of the note
+		double centre = frequency * fftsize / samplerate;
+		int spread = (int)ceil(2.0 * fftsize / length) + 2;
+		int lo = std::max(0, (int)floor(centre) - spread);
+		int hi = std::min(last, (int)ceil(centre) + spread);
+
+		// DFT of the temporal kernel at each of those bins, conjugated ready for the dot product
+		kernelReal.assign(hi - lo + 1, 0.0);
+		kernelImag.assign(hi - lo + 1, 0.0);
+		double largest = 0.0;
+		for (int j = lo; j <= hi; j += 1) {
+			double step = omega - 2.0 * M_PI * j / fftsize;
+			double sumReal = 0.0, sumImag = 0.0;
+			for (int n = 0; n < length; n += 1) {
+				double w = (0.5 - 0.5 * cos(2.0 * M_PI * n / length)) / length;
+				sumReal += w * cos(step * n);
+				sumImag += w * sin(step * n);
+			}
+			// refer the kernel to its place in the frame
+			double shift = -2.0 * M_PI * j * start / fftsize;
+			double re = sumReal * cos(shift) - sumImag * sin(shift);
+			double im = sumReal * sin(shift) + sumImag * cos(shift);
+			kernelReal[j - lo] = re;
+			kernelImag[j - lo] = -im;
+			largest = std::max(largest, sqrt(re * re + im * im));
+		}
+
+		// keep the run of coefficients above the threshold
+		int from = 0, to = hi - lo;
+		double threshold = CQT_KERNEL_THRESHOLD * largest;
+		while (from < to && sqrt(kernelReal[from] * kernelReal[from] + kernelImag[from] * kernelImag[from]) < threshold) {
+			from += 1;
+		}
+		while (to > from && sqrt(kernelReal[to] * kernelReal[to] + kernelImag[to] * kernelImag[to]) < threshold) {
+			to -= 1;
+		}
+
+		this->first[k] = lo + from;
+		this->real.insert(this->real.end(), kernelReal.begin() + from, kernelReal.begin() + to + 1);
+		this->imag.insert(this->imag.end(), kernelImag.begin() + from, kernelImag.begin() + to + 1);
+		this->offset[k + 1] = (int)this->real.size();
+	}
+
+	return 0;
+}
+
+// Magnitudes of the lowest 'count' constant-Q bins, from the complex spectrum (fftsize / 2 + 1 bins)
+// of a window. The spectrum's own window multiplies each kernel's, which only widens the longest
+// kernels slightly. The magnitudes are on the same scale as the FFT's, so a note peaks at about the
+// height it has in the linear spectrum. Safe to call from the audio thread.
+int ConstantQ::Transform(const SampleComplex* transform, Sample* out, int count) const
+{
+	if (transform == NULL || this->bins == 0) {
+		return -1;
+	}
+
+	count = std::min(count, this->bins);
+	for (int k = 0; k < count; k += 1) {
+		const SampleComplex* x = transform + this->first[k];
+		const double* kr = &this->real[this->offset[k]];
+		const double* ki = &this->imag[this->offset[k]];
+		int length = this->offset[k + 1] - this->offset[k];
+
+		double sumReal = 0.0, sumImag = 0.0;
+		for (int i = 0; i < length; i += 1) {
+			sumReal += x[i][0] * kr[i] - x[i][1] * ki[i];
+			sumImag += x[i][0] * ki[i] + x[i][1] * kr[i];
+		}
+		out[k] = (Sample)sqrt(sumReal * sumReal + sumImag * sumImag);
+	}
+
+	return count;
+}
+
+// Fold the energy of 'count' constant-Q magnitudes into the 12 pitch classes (C first), scaled so the
+// strongest class is 1 (all zero for a silent window)
+void ConstantQ::Chroma(const Sample* magnitudes, int count, double* chroma) const
+{
+	std::fill(chroma, chroma + CHROMA_BINS, 0.0);
+
+	count = std::min(count, this->bins);
+	for (int k = 0; k < count; k += 1) {
+		// semitones above A, then shifted so that C is class 0
+		int semitone = (int)floor((this->lowest + k) * 12.0 / CQT_BINS_PER_OCTAVE + 0.5);
+		int pitchClass = ((semitone + 9) % CHROMA_BINS + CHROMA_BINS) % CHROMA_BINS;
+		chroma[pitchClass] += (double)magnitudes[k] * magnitudes[k];
+	}
+
+	double largest = *std::max_element(chroma, chroma + CHROMA_BINS);
+	for (int i = 0; i < CHROMA_BINS && largest > 0.0; i += 1) {
+		chroma[i] /= largest;
+	}
+}
+
+// Number of constant-Q bins
+int ConstantQ::GetBins() const
+{
+	return this->bins;
+}
+
+// MIDI note number of a bin (69 is A4), for plotting on a note axis
+double ConstantQ::GetNote(int bin) const
+{
+	return 69.0 + (this->lowest + bin) * 12.0 / CQT_BINS_PER_OCTAVE;
+}
+
+// Centre frequency of a bin (Hz)
+double ConstantQ::GetFrequency(int bin) const
+{
+	return CQT_REFERENCE * pow(2.0, (double)(this->lowest + bin) / CQT_BINS_PER_OCTAVE);
+}
+
+// Number of kernel coefficients kept (the multiply-adds each transform costs)
+int ConstantQ::GetKernelSize() const
+{
+	return (int)this->real.size();
+}
\ No newline at end of file
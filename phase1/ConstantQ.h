@@ -0,0 +1,51 @@
+/**
+* @file		ConstantQ.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The ConstantQ class turns the complex spectrum of an analysis window into a
+* constant-Q transform with one bin per semitone (Brown & Puckette's efficient
+* method: each bin is a short sparse dot product with a precomputed spectral
+* kernel), and reduces that to a 12-bin chroma vector.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <vector>
+
+// Local includes:
+#include "AudioProcessor.h"
+
+// Constants:
+#define CQT_BINS_PER_OCTAVE 12			// constant-Q bins per octave, aligned to equal-tempered notes (default: 12)
+#define CQT_KERNEL_THRESHOLD 0.01		// kernel coefficients below this fraction of their bin's largest are dropped (default: 0.01)
+#define CQT_MAX_HARMONIC 4				// the display reaches this harmonic of the highest note (default: 4)
+#define CQT_REFERENCE 440.0				// tuning reference (A4, MIDI note 69) for the bin frequencies (Hz)
+#define CHROMA_BINS 12					// pitch classes, C first
+
+class ConstantQ
+{
+public:
+	// Constructors/destructors:
+	ConstantQ();
+
+	// Methods:
+	int		Prepare(int fftsize, double samplerate, double minfrequency, double maxfrequency);
+	int		Transform(const SampleComplex* transform, Sample* out, int count) const;
+	void	Chroma(const Sample* magnitudes, int count, double* chroma) const;
+	int		GetBins() const;
+	double	GetNote(int bin) const;
+	double	GetFrequency(int bin) const;
+	int		GetKernelSize() const;
+
+private:
+	// Private variables:
+	int					fftSize;		// transform size the kernel was built for
+	int					bins;			// number of constant-Q bins
+	int					lowest;			// the lowest bin, in bins above (or below) the reference
+	std::vector<int>	first;			// each bin's first FFT bin in the kernel
+	std::vector<int>	offset;			// each bin's first coefficient (bins + 1 entries)
+	std::vector<double>	real;			// conjugated spectral kernels, each a contiguous run of FFT bins
+	std::vector<double>	imag;
+};
\ No newline at end of file
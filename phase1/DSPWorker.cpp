@@ -0,0 +1,252 @@
+/**
+* @file		DSPWorker.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The DSPWorker class runs the analysis pipeline on its own thread. The audio
+* callback only copies samples into a lock-free FIFO, so analysis spikes can
+* no longer cause input overflows. A worker can serve a group of channels,
+* each with its own FIFO and pipeline.
+**/
+
+#include "DSPWorker.h"
+
+// Platform includes (for thread priority/affinity):
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#endif
+
+// ****** Constructors:
+DSPWorker::DSPWorker(AnalysisPipeline* pipeline, int chunkframes, int fifoframes)
+{
+	this->pipelines.push_back(pipeline);
+	this->Init(chunkframes, fifoframes);
+}
+
+// A worker for a group of channels, in the order their samples are pushed
+DSPWorker::DSPWorker(const std::vector<AnalysisPipeline*>& pipelines, int chunkframes, int fifoframes)
+{
+	this->pipelines = pipelines;
+	this->Init(chunkframes, fifoframes);
+}
+
+// ****** Destructor:
+DSPWorker::~DSPWorker()
+{
+	this->Stop();
+
+	for (size_t i = 0; i < this->fifos.size(); i += 1) {
+		delete this->fifos[i];
+		delete this->gaps[i];
+	}
+
+#ifdef _WIN32
+	if (this->event != NULL) {
+		CloseHandle(this->event);
+	}
+#else
+	sem_destroy(&this->semaphore);
+#endif
+}
+
+// ****** Methods:
+// Launch the worker thread, optionally at real-time priority and/or pinned to a core
+int DSPWorker::Start(bool realtime, int cpu)
+{
+	if (this->running) {
+		return 0;
+	}
+#ifdef _WIN32
+	if (this->event == NULL) {
+		return -1;
+	}
+#endif
+
+	this->realtime = realtime;
+	this->cpu = cpu;
+	this->running = true;
+
+	try {
+		this->thread = std::thread(&DSPWorker::Run, this);
+	}
+	catch (std::system_error&) {
+		this->running = false;
+		return -1;
+	}
+
+	return 0;
+}
+
+// Ask the worker thread to finish and wait for it
+void DSPWorker::Stop()
+{
+	if (!this->running) {
+		return;
+	}
+
+	this->running = false;
+	this->Signal();
+	if (this->thread.joinable()) {
+		this->thread.join();
+	}
+}
+
+// Queue samples for analysis (audio thread only). Never blocks; returns the number of samples
+// that fit, the rest are dropped.
+size_t DSPWorker::PushSamples(const Sample* data, size_t frames)
+{
+	size_t written = this->PushSamples(0, data, frames);
+	this->Signal();
+
+	return written;
+}
+
+// Queue one channel's samples for analysis (audio thread only), without waking the worker, so that
+// a whole device buffer can be handed over before a single Wake. Once samples have been dropped,
+// nothing more is queued until the worker has caught up to the gap and restarted the channel.
+size_t DSPWorker::PushSamples(int channel, const Sample* data, size_t frames)
+{
+	if (this->gaps[channel]->load(std::memory_order_acquire)) {
+		return 0;
+	}
+
+	size_t written = this->fifos[channel]->Write(data, frames);
+	if (written < frames) {
+		this->gaps[channel]->store(true, std::memory_order_release);
+	}
+	return written;
+}
+
+// Let the worker know that samples are waiting (audio thread only)
+void DSPWorker::Wake()
+{
+	this->Signal();
+}
+
+// One FIFO per channel, and the buffer samples are taken out of them through
+void DSPWorker::Init(int chunkframes, int fifoframes)
+{
+	for (size_t i = 0; i < this->pipelines.size(); i += 1) {
+		this->fifos.push_back(new SpscRing<Sample>(fifoframes));
+		this->gaps.push_back(new std::atomic<bool>(false));
+	}
+	this->chunk.assign(chunkframes, 0.0);
+	this->running = false;
+	this->realtime = false;
+	this->cpu = DSP_WORKER_ANY_CPU;
+
+	this->pending = false;
+#ifdef _WIN32
+	this->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+#else
+	sem_init(&this->semaphore, 0, 0);
+#endif
+}
+
+// Worker thread body: pass samples from the FIFOs through the pipelines as they arrive
+void DSPWorker::Run()
+{
+	this->ApplyScheduling();
+
+	while (this->running) {
+		// a wake-up signalled from here on is for samples this pass may not see
+		this->pending.store(false);
+
+		// the pipelines' sliding windows decide when there is enough for an analysis; each channel
+		// gets a chunk in turn, so none of them falls behind the others
+		bool busy = false;
+		for (size_t i = 0; i < this->fifos.size(); i += 1) {
+			bool gap = this->gaps[i]->load(std::memory_order_acquire);
+			size_t got = this->fifos[i]->Read(&this->chunk[0], this->chunk.size());
+			if (got > 0) {
+				this->pipelines[i]->PushSamples(&this->chunk[0], (int)got);
+				busy = true;
+			}
+			else if (gap) {
+				// everything queued before the samples were dropped has been analysed; no window (or
+				// estimator state, such as target mode's phases) may span the gap, so start afresh
+				this->pipelines[i]->Reset();
+				this->gaps[i]->store(false, std::memory_order_release);
+				busy = true;
+			}
+		}
+		if (busy) {
+			continue;
+		}
+
+		// nothing to do yet; sleep until the audio thread signals, or the timeout passes
+		this->WaitForSamples();
+	}
+}
+
+// Wake the worker. Called from the audio callback, so it only sets a flag and, the first time since
+// the worker last looked, makes a single kernel call: a condition variable's notify can take locks
+// or allocate (on VS2013 it goes through the ConcRT scheduler).
+void DSPWorker::Signal()
+{
+	if (this->pending.exchange(true)) {
+		return;
+	}
+
+#ifdef _WIN32
+	SetEvent(this->event);
+#else
+	sem_post(&this->semaphore);
+#endif
+}
+
+// Sleep until Signal is called, or DSP_WORKER_WAIT_MS passes
+void DSPWorker::WaitForSamples()
+{
+#ifdef _WIN32
+	WaitForSingleObject(this->event, DSP_WORKER_WAIT_MS);
+#else
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += DSP_WORKER_WAIT_MS * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec += 1;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	while (sem_timedwait(&this->semaphore, &deadline) != 0 && errno == EINTR) {
+	}
+#endif
+}
+
+// Raise the worker's priority and pin it to a core, as requested. Failures (e.g. missing
+// privileges for SCHED_FIFO) are not fatal; the worker simply runs with default scheduling.
+void DSPWorker::ApplyScheduling()
+{
+#ifdef _WIN32
+	HANDLE handle = GetCurrentThread();
+	if (this->realtime) {
+		SetThreadPriority(handle, THREAD_PRIORITY_TIME_CRITICAL);
+	}
+	if (this->cpu != DSP_WORKER_ANY_CPU) {
+		SetThreadAffinityMask(handle, (DWORD_PTR)1 << this->cpu);
+	}
+#else
+	pthread_t handle = pthread_self();
+	if (this->realtime) {
+		struct sched_param param;
+		param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+		pthread_setschedparam(handle, SCHED_FIFO, &param);
+	}
+#ifdef __linux__
+	if (this->cpu != DSP_WORKER_ANY_CPU) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(this->cpu, &set);
+		pthread_setaffinity_np(handle, sizeof(set), &set);
+	}
+#endif
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+/**
+* @file		DSPWorker.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The DSPWorker class runs the analysis pipeline on its own thread. The audio
+* callback only copies samples into a lock-free FIFO, so analysis spikes can
+* no longer cause input overflows. A worker can serve a group of channels,
+* each with its own FIFO and pipeline.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <system_error>
+
+// Platform includes (for the wake-up signal):
+#ifndef _WIN32
+#include <semaphore.h>
+#endif
+
+// Local includes:
+#include "AnalysisPipeline.h"
+#include "SpscRing.h"
+
+// Constants:
+#define DSP_WORKER_WAIT_MS 5			// longest the worker sleeps before re-checking the FIFO
+#define DSP_WORKER_ANY_CPU -1			// don't pin the worker to a core
+
+class DSPWorker
+{
+public:
+	// Constructors/destructors:
+	DSPWorker(AnalysisPipeline* pipeline, int chunkframes, int fifoframes);
+	DSPWorker(const std::vector<AnalysisPipeline*>& pipelines, int chunkframes, int fifoframes);
+	~DSPWorker();
+
+	// Methods:
+	int		Start(bool realtime = false, int cpu = DSP_WORKER_ANY_CPU);
+	void	Stop();
+	size_t	PushSamples(const Sample* data, size_t frames);
+	size_t	PushSamples(int channel, const Sample* data, size_t frames);
+	void	Wake();
+	int		GetChannels() const { return (int)pipelines.size(); }
+	bool	IsRunning() const { return running.load(); }
+
+private:
+	// Private methods:
+	void	Init(int chunkframes, int fifoframes);
+	void	Run();
+	void	ApplyScheduling();
+	void	Signal();
+	void	WaitForSamples();
+
+	// Private variables:
+	std::vector<AnalysisPipeline*>	pipelines;	// one per channel served
+	std::vector<SpscRing<Sample>*>	fifos;		// each channel's samples, from the audio thread to the worker
+	std::vector<std::atomic<bool>*>	gaps;		// whether a channel's FIFO overflowed and its stream must restart
+	std::vector<Sample>		chunk;			// samples taken from the FIFO in one go
+	std::thread				thread;
+#ifdef _WIN32
+	void*					event;			// auto-reset event (a HANDLE) the audio thread sets
+#else
+	sem_t					semaphore;		// posted by the audio thread
+#endif
+	std::atomic<bool>		pending;		// whether a wake-up has been signalled and not yet seen
+	std::atomic<bool>		running;
+	bool					realtime;
+	int						cpu;
+};
\ No newline at end of file
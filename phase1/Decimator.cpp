@@ -0,0 +1,169 @@
+/**
+* @file		Decimator.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The Decimator class is a stateful FIR decimator that brings the device's
+* native-rate stream down to the analysis rate. Its Kaiser-windowed low-pass
+* is the anti-aliasing filter, and only the samples that are kept are ever
+* computed, so each input sample costs taps / factor multiply-adds. The delay
+* line carries over between blocks.
+**/
+
+#include "Decimator.h"
+
+// ****** Constructors:
+Decimator::Decimator()
+{
+	factor = 1;
+	taps = 0;
+	coefficients = NULL;
+	history = NULL;
+	position = 0;
+	phase = 0;
+	sampleRate = 0.0;
+	passband = 0.0;
+	useSIMD = SimdHasSSE2();
+}
+
+// ****** Destructor:
+Decimator::~Decimator()
+{
+	FFTW(free)(this->coefficients);
+	FFTW(free)(this->history);
+}
+
+// ****** Methods:
+// Design the anti-aliasing filter for decimating 'samplerate' by 'factor', keeping everything up to
+// 'passband' Hz and reaching full attenuation at the new Nyquist frequency. Allocates, so it must
+// only be called while the audio stream is stopped; nothing is redesigned if nothing changed.
+int Decimator::SetParams(int factor, double samplerate, double passband)
+{
+	if (factor == this->factor && samplerate == this->sampleRate && passband == this->passband && this->taps > 0) {
+		this->Reset();
+		return 0;
+	}
+	if (factor < 2 || samplerate <= 0.0) {
+		return -1;
+	}
+
+	double stopband = samplerate / factor / 2.0;
+	double edge = std::min(passband, 0.9 * stopband);
+
+	double beta;
+	int length = AudioProcessor::KaiserFIRLength(samplerate, edge, stopband, DECIMATOR_ATTENUATION, &beta);
+	if (length <= 0) {
+		return -1;
+	}
+	length += (length & 1);		// even length, so the kernel can work two taps at a time
+
+	FFTW(free)(this->coefficients);
+	FFTW(free)(this->history);
+	this->coefficients = (Sample*)FFTW(malloc)(sizeof(Sample) * length);
+	this->history = (Sample*)FFTW(malloc)(sizeof(Sample) * 2 * length);
+	if (this->coefficients == NULL || this->history == NULL) {
+		FFTW(free)(this->coefficients);
+		FFTW(free)(this->history);
+		this->coefficients = NULL;
+		this->history = NULL;
+		this->taps = 0;
+		return -1;
+	}
+
+	AudioProcessor::DesignLowPassFIR(this->coefficients, length, samplerate, (edge + stopband) / 2.0, beta);
+	this->factor = factor;
+	this->taps = length;
+	this->sampleRate = samplerate;
+	this->passband = passband;
+	this->Reset();
+
+	return 0;
+}
+
+// Clear the delay line (e.g. when a new stream starts)
+void Decimator::Reset()
+{
+	if (this->history != NULL) {
+		memset(this->history, 0, sizeof(Sample) * 2 * this->taps);
+	}
+	this->position = 0;
+	this->phase = 0;
+}
+
+// Enable or disable the SIMD kernel (it is never used on CPUs without SSE2)
+void Decimator::SetUseSIMD(bool enable)
+{
+	this->useSIMD = enable && SimdHasSSE2();
+}
+
+// Feed 'count' input samples through the filter and write every 'factor'-th output to 'out', which
+// needs room for count / factor + 1 samples. If 'level' is given, the output's energy and peak are
+// added to it. Returns the number of samples written.
+int Decimator::Process(const Sample* in, int count, Sample* out, SampleLevel* level)
+{
+	if (this->taps == 0) {
+		return 0;
+	}
+
+	int produced = 0;
+	double energy = 0.0, peak = 0.0;
+	for (int i = 0; i < count; i += 1) {
+		// write the sample into both halves of the delay line
+		this->history[this->position] = in[i];
+		this->history[this->position + this->taps] = in[i];
+		this->position += 1;
+		if (this->position == this->taps) {
+			this->position = 0;
+		}
+
+		// only the samples that survive decimation are filtered
+		this->phase += 1;
+		if (this->phase == this->factor) {
+			this->phase = 0;
+			Sample y = this->DotProduct(&this->history[this->position]);
+			out[produced] = y;
+			energy += (double)y * y;
+			peak = std::max(peak, fabs((double)y));
+			produced += 1;
+		}
+	}
+
+	if (level != NULL) {
+		level->energy += energy;
+		level->peak = std::max(level->peak, peak);
+	}
+
+	return produced;
+}
+
+// Filter output for one contiguous window of inputs (oldest first)
+Sample Decimator::DotProduct(const Sample* window) const
+{
+	const Sample* h = this->coefficients;
+	int i = 0;
+	Sample sum = 0;
+
+#ifdef SIMD_HAVE_SSE2
+	if (this->useSIMD) {
+		// two accumulators hide the add latency; the window is not vector-aligned
+		SampleVector acc0 = SampleZero();
+		SampleVector acc1 = SampleZero();
+		for (; i + 2 * SAMPLE_LANES <= this->taps; i += 2 * SAMPLE_LANES) {
+			acc0 = SampleAdd(acc0, SampleMul(SampleLoad(&h[i]), SampleLoad(&window[i])));
+			acc1 = SampleAdd(acc1, SampleMul(SampleLoad(&h[i + SAMPLE_LANES]), SampleLoad(&window[i + SAMPLE_LANES])));
+		}
+		acc0 = SampleAdd(acc0, acc1);
+		if (i + SAMPLE_LANES <= this->taps) {
+			acc0 = SampleAdd(acc0, SampleMul(SampleLoad(&h[i]), SampleLoad(&window[i])));
+			i += SAMPLE_LANES;
+		}
+		sum = SampleSum(acc0);
+	}
+#endif
+
+	for (; i < this->taps; i += 1) {
+		sum += h[i] * window[i];
+	}
+
+	return sum;
+}
\ No newline at end of file
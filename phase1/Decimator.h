@@ -0,0 +1,51 @@
+/**
+* @file		Decimator.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The Decimator class is a stateful FIR decimator that brings the device's
+* native-rate stream down to the analysis rate. Its Kaiser-windowed low-pass
+* is the anti-aliasing filter, and only the samples that are kept are ever
+* computed, so each input sample costs taps / factor multiply-adds. The delay
+* line carries over between blocks.
+*/
+
+#pragma once
+
+// Local includes:
+#include "AudioProcessor.h"
+
+// Constants:
+#define DECIMATOR_ATTENUATION 80.0		// stopband attenuation of the anti-aliasing filter, in dB (default: 80)
+
+class Decimator
+{
+public:
+	// Constructors/destructors:
+	Decimator();
+	~Decimator();
+
+	// Methods:
+	int		SetParams(int factor, double samplerate, double passband);
+	void	Reset();
+	int		Process(const Sample* in, int count, Sample* out, SampleLevel* level = NULL);
+	int		InputsFor(int outputs) const { return outputs * factor - phase; }
+	int		GetFactor() const { return factor; }
+	int		GetTaps() const { return taps; }
+	void	SetUseSIMD(bool enable);
+
+private:
+	// Private methods:
+	Sample	DotProduct(const Sample* window) const;
+
+	// Private variables:
+	int		factor;				// input samples per output sample
+	int		taps;				// filter length (even, for the SSE2 kernel)
+	Sample*	coefficients;		// filter taps (symmetric, so no reversal is needed)
+	Sample*	history;			// the last 'taps' inputs, stored twice so any window is contiguous
+	int		position;			// where the next input goes in 'history'
+	int		phase;				// inputs since the last output
+	double	sampleRate;
+	double	passband;
+	bool	useSIMD;			// take the SSE2 path (only if the CPU supports it)
+};
\ No newline at end of file
@@ -0,0 +1,139 @@
+/**
+* @file		HPSEstimator.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The HPSEstimator class estimates the fundamental frequency with the (log
+* domain) Harmonic Product Spectrum of each window's spectrum.
+**/
+
+#include "HPSEstimator.h"
+
+// ****** Constructors:
+HPSEstimator::HPSEstimator(int harmonics, PitchRefinement refinement)
+{
+	this->proc = NULL;
+	this->harmonics = harmonics;
+	this->refinement = refinement;
+	this->bins = 0;
+	this->binSize = 0.0;
+	this->scratch = NULL;
+	this->previous = NULL;
+	this->previousValid = false;
+}
+
+// ****** Destructor:
+HPSEstimator::~HPSEstimator()
+{
+	FFTW(free)(this->scratch);
+	FFTW(free)(this->previous);
+}
+
+// ****** Methods:
+// Size the HPS scratch buffers for the spectrum of a 'frames'-sample window
+int HPSEstimator::Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+						double maxfrequency, unsigned int plannerflags)
+{
+	if (frames <= 0 || samplerate <= 0.0) {
+		return -1;
+	}
+
+	this->proc = proc;
+	this->binSize = samplerate / (double)frames;
+
+	int bins = frames / 2 + 1;
+	if (bins != this->bins) {
+		FFTW(free)(this->scratch);
+		FFTW(free)(this->previous);
+		this->scratch = (Sample*)FFTW(malloc)(sizeof(Sample) * 2 * bins);
+		this->previous = (SampleComplex*)FFTW(malloc)(sizeof(SampleComplex) * bins);
+		if (this->scratch == NULL || this->previous == NULL) {
+			this->bins = 0;
+			return -1;
+		}
+		this->bins = bins;
+	}
+
+	// a new stream has no previous window to compare phases with
+	this->Reset();
+
+	return 0;
+}
+
+// Perform the Harmonic Product Spectrum and determine the fundamental frequency
+bool HPSEstimator::Estimate(const PitchInput& input, PitchEstimate* estimate)
+{
+	if (input.logspectrum == NULL || input.bins != this->bins) {
+		return false;
+	}
+
+	int fundamentalBin = this->FindPeak(input.logspectrum, &estimate->confidence);
+	estimate->frequency = (this->RefineBin(input, fundamentalBin) * this->binSize);
+
+	// keep this window's phases for the next one
+	if (input.transform != NULL) {
+		memcpy(this->previous, input.transform, sizeof(SampleComplex) * this->bins);
+		this->previousValid = true;
+	}
+
+	return true;
+}
+
+// Find the HPS bin of the likely fundamental, and the confidence in it
+int HPSEstimator::FindPeak(const Sample* logspectrum, double* confidence)
+{
+	return this->proc->LogHPS(logspectrum, this->bins, this->harmonics, this->scratch, confidence);
+}
+
+// Turn the HPS bin into a fractional bin. The HPS maximum can sit a bin away from the fundamental's
+// own spectral peak, so the refinement starts from the highest of the three.
+double HPSEstimator::RefineBin(const PitchInput& input, int bin)
+{
+	const Sample* logspectrum = input.logspectrum;
+	if (this->refinement == REFINE_NONE || bin <= 0 || bin >= input.bins - 1) {
+		return (double)bin;
+	}
+
+	int peak = bin;
+	if (logspectrum[bin - 1] > logspectrum[peak]) {
+		peak = bin - 1;
+	}
+	if (logspectrum[bin + 1] > logspectrum[peak]) {
+		peak = bin + 1;
+	}
+	if (peak <= 0 || peak >= input.bins - 1) {
+		return (double)peak;
+	}
+
+	if (this->refinement == REFINE_QUADRATIC) {
+		Sample magnitudes[3];
+		for (int i = 0; i < 3; i += 1) {
+			magnitudes[i] = (Sample)pow(10.0, logspectrum[peak - 1 + i]);
+		}
+		return (peak - 1) + AudioProcessor::InterpolatePeak(magnitudes, 3, 1);
+	}
+
+	double refined = AudioProcessor::InterpolatePeak(logspectrum, input.bins, peak);
+
+	// the phase vocoder is only trusted when it agrees with the interpolated peak
+	if (this->refinement == REFINE_PHASE_VOCODER && this->previousValid && input.transform != NULL && input.hop > 0) {
+		int frames = 2 * (this->bins - 1);
+		double vocoded = AudioProcessor::PhaseVocoderBin(input.transform, this->previous, peak, frames, input.hop);
+		if (fabs(vocoded - refined) < 1.0) {
+			refined = vocoded;
+		}
+	}
+
+	return refined;
+}
+
+// The windows either side of a gap are too far apart to compare phases
+void HPSEstimator::Reset()
+{
+	this->previousValid = false;
+}
+
+const char* HPSEstimator::Name() const
+{
+	return "HPS";
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+/**
+* @file		HPSEstimator.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The HPSEstimator class estimates the fundamental frequency with the (log
+* domain) Harmonic Product Spectrum of each window's spectrum.
+*/
+
+#pragma once
+
+// Local includes:
+#include "PitchEstimator.h"
+
+class HPSEstimator : public PitchEstimator
+{
+public:
+	// Constructors/destructors:
+	HPSEstimator(int harmonics, PitchRefinement refinement = REFINE_PHASE_VOCODER);
+	~HPSEstimator();
+
+	// Methods:
+	int			Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+						double maxfrequency, unsigned int plannerflags);
+	bool		Estimate(const PitchInput& input, PitchEstimate* estimate);
+	void		Reset();
+	const char*	Name() const;
+
+protected:
+	// Protected methods:
+	virtual int	FindPeak(const Sample* logspectrum, double* confidence);
+
+private:
+	// Private methods:
+	double		RefineBin(const PitchInput& input, int bin);
+
+	// Private variables:
+	AudioProcessor*	proc;
+	int				harmonics;		// number of downsampled spectra multiplied together
+	PitchRefinement	refinement;
+	int				bins;			// spectrum size the scratch buffers are sized for
+	double			binSize;		// Hz per spectrum bin
+	Sample*			scratch;		// LogHPS scratch (2 * bins)
+	SampleComplex*	previous;		// the previous window's complex spectrum, for the phase vocoder
+	bool			previousValid;
+};
\ No newline at end of file
@@ -0,0 +1,237 @@
+/**
+* @file		LowPassFilter.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The LowPassFilter class is a stateful cascade of two identical biquad
+* low-pass sections. Coefficients are computed once per sample rate/cutoff
+* change and the filter state carries over between blocks, so the signal is
+* filtered continuously rather than restarting at every buffer.
+**/
+
+#include "LowPassFilter.h"
+#include "SimdSupport.h"
+
+// ****** Constructors:
+LowPassFilter::LowPassFilter()
+{
+	sampleRate = 0.0;
+	cutoff = 0.0;
+	a[0] = a[1] = 0.0;
+	b[0] = 1.0;
+	b[1] = b[2] = 0.0;
+	useSIMD = SimdHasSSE2();
+	Reset();
+}
+
+// ****** Methods:
+// Recompute the coefficients, but only if the sample rate or cutoff actually changed
+void LowPassFilter::SetParams(double samplerate, double cutoff)
+{
+	if (samplerate == this->sampleRate && cutoff == this->cutoff) {
+		return;
+	}
+
+	this->sampleRate = samplerate;
+	this->cutoff = cutoff;
+	AudioProcessor::CalcLowPassParams(samplerate, cutoff, this->a, this->b);
+}
+
+// Clear the filter state (e.g. when a new stream starts)
+void LowPassFilter::Reset()
+{
+	s1[0] = s1[1] = 0.0;
+	s2[0] = s2[1] = 0.0;
+}
+
+// Enable or disable the SIMD kernels (they are never used on CPUs without SSE2)
+void LowPassFilter::SetUseSIMD(bool enable)
+{
+	this->useSIMD = enable && SimdHasSSE2();
+}
+
+// Filter a block of samples, continuing from where the previous block left off. In-place
+// operation (in == out) is allowed. If 'level' is given, the output's energy and peak are added to it.
+void LowPassFilter::Process(const Sample* in, Sample* out, int count, SampleLevel* level)
+{
+	if (in != out) {
+		memcpy(out, in, sizeof(Sample) * count);
+	}
+
+	this->ProcessBlock(out, count, level);
+}
+
+// Filter a block of samples in place, using the fastest kernel available
+void LowPassFilter::ProcessBlock(double* data, int count, SampleLevel* level)
+{
+#ifdef SIMD_HAVE_SSE2
+	if (this->useSIMD) {
+		this->ProcessSSE2(data, count, level);
+		return;
+	}
+#endif
+	this->ProcessScalar(data, count, level);
+}
+
+// Filter a block of single-precision samples in place (the state is kept in double precision)
+void LowPassFilter::ProcessBlock(float* data, int count, SampleLevel* level)
+{
+#ifdef SIMD_HAVE_SSE2
+	if (this->useSIMD) {
+		this->ProcessSSE2(data, count, level);
+		return;
+	}
+#endif
+	this->ProcessScalar(data, count, level);
+}
+
+// Portable kernel: both sections, one sample at a time. The output's level is measured on the way
+// out; those few operations hide in the latency of the recurrence, so every kernel always does it.
+template <typename T>
+void LowPassFilter::ProcessScalar(T* data, int count, SampleLevel* level)
+{
+	// keep the coefficients and state in locals for the duration of the loop
+	const double a1 = a[0], a2 = a[1], b0 = b[0], b1 = b[1], b2 = b[2];
+	double p1 = s1[0], p2 = s1[1], q1 = s2[0], q2 = s2[1];
+	double energy = 0.0, peak = 0.0;
+
+	for (int i = 0; i < count; i += 1) {
+		// apply filter twice for good measure
+		double x = data[i];
+		double y = (b0 * x) + p1;
+		p1 = (b1 * x) - (a1 * y) + p2;
+		p2 = (b2 * x) - (a2 * y);
+
+		double v = (b0 * y) + q1;
+		q1 = (b1 * y) - (a1 * v) + q2;
+		q2 = (b2 * y) - (a2 * v);
+
+		data[i] = (T)v;
+		energy += v * v;
+		peak = std::max(peak, fabs(v));
+	}
+
+	s1[0] = p1; s1[1] = p2;
+	s2[0] = q1; s2[1] = q2;
+	if (level != NULL) {
+		level->energy += energy;
+		level->peak = std::max(level->peak, peak);
+	}
+}
+
+#ifdef SIMD_HAVE_SSE2
+// SSE2 kernel: lane 0 runs the first section on sample i while lane 1 runs the second section on
+// the first section's output for sample i-1, so the two recurrences advance together. The first
+// and last step of each block are done in scalar code to fill and drain the pipeline, which keeps
+// the output identical to the scalar kernel.
+void LowPassFilter::ProcessSSE2(double* data, int count, SampleLevel* level)
+{
+	if (count < 2) {
+		this->ProcessScalar(data, count, level);
+		return;
+	}
+
+	const double a1 = a[0], a2 = a[1], b0 = b[0], b1 = b[1], b2 = b[2];
+
+	// prologue: first section only, for sample 0
+	double y = (b0 * data[0]) + s1[0];
+	s1[0] = (b1 * data[0]) - (a1 * y) + s1[1];
+	s1[1] = (b2 * data[0]) - (a2 * y);
+
+	// fused loop, with the state of both sections packed as [first, second]
+	const __m128d B0 = _mm_set1_pd(b0), B1 = _mm_set1_pd(b1), B2 = _mm_set1_pd(b2);
+	const __m128d A1 = _mm_set1_pd(a1), A2 = _mm_set1_pd(a2);
+	__m128d S1 = _mm_set_pd(s2[0], s1[0]);
+	__m128d S2 = _mm_set_pd(s2[1], s1[1]);
+	__m128d Y = _mm_set_sd(y);
+	const __m128d SIGN = _mm_set1_pd(-0.0);
+	__m128d E = _mm_setzero_pd();		// lane 1: energy and peak of the output so far
+	__m128d P = _mm_setzero_pd();
+
+	for (int i = 1; i < count; i += 1) {
+		// input: [x[i], first-section output for i-1]
+		__m128d X = _mm_unpacklo_pd(_mm_load_sd(&data[i]), Y);
+		Y = _mm_add_pd(_mm_mul_pd(B0, X), S1);
+		S1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(B1, X), _mm_mul_pd(A1, Y)), S2);
+		S2 = _mm_sub_pd(_mm_mul_pd(B2, X), _mm_mul_pd(A2, Y));
+
+		// lane 1 now holds the finished output for sample i-1
+		_mm_storeh_pd(&data[i - 1], Y);
+		E = _mm_add_pd(E, _mm_mul_pd(Y, Y));
+		P = _mm_max_pd(P, _mm_andnot_pd(SIGN, Y));
+	}
+
+	// unpack the state
+	double lo[2], hi[2];
+	_mm_storeu_pd(lo, S1);
+	_mm_storeu_pd(hi, S2);
+	s1[0] = lo[0]; s2[0] = lo[1];
+	s1[1] = hi[0]; s2[1] = hi[1];
+	y = _mm_cvtsd_f64(Y);
+
+	// epilogue: second section only, for the last sample
+	double v = (b0 * y) + s2[0];
+	s2[0] = (b1 * y) - (a1 * v) + s2[1];
+	s2[1] = (b2 * y) - (a2 * v);
+	data[count - 1] = v;
+
+	if (level != NULL) {
+		level->energy += _mm_cvtsd_f64(_mm_unpackhi_pd(E, E)) + v * v;
+		level->peak = std::max(level->peak, std::max(_mm_cvtsd_f64(_mm_unpackhi_pd(P, P)), fabs(v)));
+	}
+}
+
+// Single-precision variant: converts to double on the way in and out of the fused loop, so the
+// recurrence itself keeps full precision
+void LowPassFilter::ProcessSSE2(float* data, int count, SampleLevel* level)
+{
+	if (count < 2) {
+		this->ProcessScalar(data, count, level);
+		return;
+	}
+
+	const double a1 = a[0], a2 = a[1], b0 = b[0], b1 = b[1], b2 = b[2];
+
+	double x0 = data[0];
+	double y = (b0 * x0) + s1[0];
+	s1[0] = (b1 * x0) - (a1 * y) + s1[1];
+	s1[1] = (b2 * x0) - (a2 * y);
+
+	const __m128d B0 = _mm_set1_pd(b0), B1 = _mm_set1_pd(b1), B2 = _mm_set1_pd(b2);
+	const __m128d A1 = _mm_set1_pd(a1), A2 = _mm_set1_pd(a2);
+	__m128d S1 = _mm_set_pd(s2[0], s1[0]);
+	__m128d S2 = _mm_set_pd(s2[1], s1[1]);
+	__m128d Y = _mm_set_sd(y);
+	const __m128d SIGN = _mm_set1_pd(-0.0);
+	__m128d E = _mm_setzero_pd();
+	__m128d P = _mm_setzero_pd();
+
+	for (int i = 1; i < count; i += 1) {
+		__m128d X = _mm_unpacklo_pd(_mm_cvtss_sd(_mm_setzero_pd(), _mm_load_ss(&data[i])), Y);
+		Y = _mm_add_pd(_mm_mul_pd(B0, X), S1);
+		S1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(B1, X), _mm_mul_pd(A1, Y)), S2);
+		S2 = _mm_sub_pd(_mm_mul_pd(B2, X), _mm_mul_pd(A2, Y));
+
+		_mm_store_ss(&data[i - 1], _mm_cvtsd_ss(_mm_setzero_ps(), _mm_unpackhi_pd(Y, Y)));
+		E = _mm_add_pd(E, _mm_mul_pd(Y, Y));
+		P = _mm_max_pd(P, _mm_andnot_pd(SIGN, Y));
+	}
+
+	double lo[2], hi[2];
+	_mm_storeu_pd(lo, S1);
+	_mm_storeu_pd(hi, S2);
+	s1[0] = lo[0]; s2[0] = lo[1];
+	s1[1] = hi[0]; s2[1] = hi[1];
+	y = _mm_cvtsd_f64(Y);
+
+	double v = (b0 * y) + s2[0];
+	s2[0] = (b1 * y) - (a1 * v) + s2[1];
+	s2[1] = (b2 * y) - (a2 * v);
+	data[count - 1] = (float)v;
+
+	if (level != NULL) {
+		level->energy += _mm_cvtsd_f64(_mm_unpackhi_pd(E, E)) + v * v;
+		level->peak = std::max(level->peak, std::max(_mm_cvtsd_f64(_mm_unpackhi_pd(P, P)), fabs(v)));
+	}
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+/**
+* @file		LowPassFilter.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The LowPassFilter class is a stateful cascade of two identical biquad
+* low-pass sections. Coefficients are computed once per sample rate/cutoff
+* change and the filter state carries over between blocks, so the signal is
+* filtered continuously rather than restarting at every buffer.
+*
+* Blocks are processed with the sections in transposed direct form II. When
+* the CPU supports SSE2, both sections run fused in one vector register, with
+* the second section working one sample behind the first.
+*/
+
+#pragma once
+
+// Local includes:
+#include "AudioProcessor.h"
+
+class LowPassFilter
+{
+public:
+	// Constructors/destructors:
+	LowPassFilter();
+
+	// Methods:
+	void	SetParams(double samplerate, double cutoff);
+	void	Reset();
+	void	Process(const Sample* in, Sample* out, int count, SampleLevel* level = NULL);
+	void	ProcessBlock(double* data, int count, SampleLevel* level = NULL);
+	void	ProcessBlock(float* data, int count, SampleLevel* level = NULL);
+	void	SetUseSIMD(bool enable);
+
+private:
+	// Private methods:
+	template <typename T> void	ProcessScalar(T* data, int count, SampleLevel* level);
+	void	ProcessSSE2(double* data, int count, SampleLevel* level);
+	void	ProcessSSE2(float* data, int count, SampleLevel* level);
+
+	// Private variables:
+	double	a[2], b[3];			// biquad coefficients (shared by both sections)
+	double	s1[2], s2[2];		// TDF-II state of the first and second section
+	double	sampleRate;
+	double	cutoff;
+	bool	useSIMD;			// take the SSE2 path (only if the CPU supports it)
+};
\ No newline at end of file
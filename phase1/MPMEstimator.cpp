@@ -0,0 +1,186 @@
+/**
+* @file		MPMEstimator.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The MPMEstimator class estimates the fundamental frequency with the McLeod
+* Pitch Method, computing the normalised square difference function from an
+* FFT autocorrelation.
+**/
+
+#include "MPMEstimator.h"
+
+// ****** Constructors:
+MPMEstimator::MPMEstimator(double cutoff)
+{
+	this->proc = NULL;
+	this->cutoff = cutoff;
+	this->sampleRate = 0.0;
+	this->frames = 0;
+	this->length = 0;
+	this->minLag = 0;
+	this->maxLag = 0;
+	this->acf = NULL;
+	this->nsdf = NULL;
+	this->peaks = NULL;
+}
+
+// ****** Destructor:
+MPMEstimator::~MPMEstimator()
+{
+	this->Release();
+}
+
+// ****** Methods:
+// Work out the lag range and analysis length, and plan the autocorrelation
+int MPMEstimator::Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+						double maxfrequency, unsigned int plannerflags)
+{
+	if (frames <= 0 || samplerate <= 0.0 || minfrequency <= 0.0 || maxfrequency <= minfrequency) {
+		return -1;
+	}
+
+	int maxlag = (int)ceil(samplerate / minfrequency);
+	int length = LagWindow(maxlag, frames);
+	if (length == 0 || proc->PrepareAutocorrelation(length, plannerflags) != 0) {
+		return -1;
+	}
+
+	this->Release();
+	this->acf = (Sample*)FFTW(malloc)(sizeof(Sample) * (maxlag + 1));
+	this->nsdf = (double*)FFTW(malloc)(sizeof(double) * (maxlag + 1));
+	this->peaks = (int*)FFTW(malloc)(sizeof(int) * (maxlag + 1));
+	if (this->acf == NULL || this->nsdf == NULL || this->peaks == NULL) {
+		this->Release();
+		return -1;
+	}
+
+	this->proc = proc;
+	this->sampleRate = samplerate;
+	this->frames = frames;
+	this->length = length;
+	this->maxLag = maxlag;
+	this->minLag = std::max(2, (int)floor(samplerate / maxfrequency));
+
+	return 0;
+}
+
+// Pick the first normalised autocorrelation peak that is nearly as high as the highest one
+bool MPMEstimator::Estimate(const PitchInput& input, PitchEstimate* estimate)
+{
+	if (input.samples == NULL || input.frames != this->frames || this->acf == NULL) {
+		return false;
+	}
+
+	// analyse the most recent samples only, reusing the pipeline's autocorrelation if it has one
+	int n = this->length;
+	const Sample* x = input.samples + (input.frames - n);
+	const Sample* r = this->acf;
+	if (input.acf != NULL && n == input.frames && input.lags > this->maxLag) {
+		r = input.acf;
+	}
+	else {
+		this->proc->Autocorrelate(x, n, this->acf, this->maxLag + 1);
+	}
+
+	// n(lag) = 2 r(lag) / m(lag), where m(lag) = sum x[j]^2 + x[j + lag]^2 over the overlap is
+	// updated incrementally; n lies in -1 .. 1, with 1 meaning a perfect repeat
+	double energy = 2.0 * r[0];
+	this->nsdf[0] = (energy > 0.0) ? 1.0 : 0.0;
+	for (int lag = 1; lag <= this->maxLag; lag += 1) {
+		energy -= x[lag - 1] * x[lag - 1] + x[n - lag] * x[n - lag];
+		this->nsdf[lag] = (energy > 0.0) ? 2.0 * r[lag] / energy : 0.0;
+	}
+
+	// collect the "key maxima": the highest point of each positive lobe after the first negative
+	// zero crossing (a lobe still rising at the longest lag has no usable peak)
+	int count = 0;
+	int lobeMax = -1;
+	bool negative = false;
+	for (int lag = 1; lag <= this->maxLag; lag += 1) {
+		double value = this->nsdf[lag];
+		if (!negative) {
+			negative = (value < 0.0);
+		}
+		else if (value > 0.0) {
+			if (lobeMax < 0 || value > this->nsdf[lobeMax]) {
+				lobeMax = lag;
+			}
+		}
+		else if (lobeMax >= 0) {
+			if (lobeMax >= this->minLag) {
+				this->peaks[count] = lobeMax;
+				count += 1;
+			}
+			lobeMax = -1;
+		}
+	}
+	if (lobeMax >= this->minLag && lobeMax < this->maxLag) {
+		this->peaks[count] = lobeMax;
+		count += 1;
+	}
+
+	if (count == 0) {
+		// no periodicity at all (e.g. silence)
+		estimate->frequency = 0.0;
+		estimate->confidence = 0.0;
+		return true;
+	}
+
+	// the earliest key maximum that comes close to the highest one is the period
+	double highest = 0.0;
+	for (int i = 0; i < count; i += 1) {
+		highest = std::max(highest, this->nsdf[this->peaks[i]]);
+	}
+	int best = this->peaks[0];
+	for (int i = 0; i < count; i += 1) {
+		if (this->nsdf[this->peaks[i]] >= this->cutoff * highest) {
+			best = this->peaks[i];
+			break;
+		}
+	}
+
+	// refine the period between samples; the peak's height (the "clarity") is the confidence
+	double period = (double)best;
+	double clarity = this->nsdf[best];
+	if (best > 1 && best < this->maxLag) {
+		double left = this->nsdf[best - 1];
+		double right = this->nsdf[best + 1];
+		double offset = ParabolicOffset(left, clarity, right);
+		period += offset;
+		clarity -= 0.25 * (left - right) * offset;
+	}
+
+	estimate->frequency = this->sampleRate / period;
+	estimate->confidence = std::max(0.0, std::min(1.0, clarity));
+
+	return true;
+}
+
+const char* MPMEstimator::Name() const
+{
+	return "MPM";
+}
+
+// Autocorrelation of the most recent 'length' samples, over lags 0 .. maxLag
+bool MPMEstimator::Autocorrelation(int* length, int* lags) const
+{
+	if (this->acf == NULL) {
+		return false;
+	}
+
+	*length = this->length;
+	*lags = this->maxLag + 1;
+	return true;
+}
+
+// Free the lag-domain buffers
+void MPMEstimator::Release()
+{
+	FFTW(free)(this->acf);
+	FFTW(free)(this->nsdf);
+	FFTW(free)(this->peaks);
+	this->acf = NULL;
+	this->nsdf = NULL;
+	this->peaks = NULL;
+}
\ No newline at end of file
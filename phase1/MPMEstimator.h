@@ -0,0 +1,48 @@
+/**
+* @file		MPMEstimator.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The MPMEstimator class estimates the fundamental frequency with the McLeod
+* Pitch Method, computing the normalised square difference function from an
+* FFT autocorrelation.
+*/
+
+#pragma once
+
+// Local includes:
+#include "PitchEstimator.h"
+
+// Constants:
+#define MPM_CUTOFF 0.9					// fraction of the highest key maximum a period must reach (default: 0.9)
+
+class MPMEstimator : public PitchEstimator
+{
+public:
+	// Constructors/destructors:
+	MPMEstimator(double cutoff = MPM_CUTOFF);
+	~MPMEstimator();
+
+	// Methods:
+	int			Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+						double maxfrequency, unsigned int plannerflags);
+	bool		Estimate(const PitchInput& input, PitchEstimate* estimate);
+	const char*	Name() const;
+	bool		Autocorrelation(int* length, int* lags) const;
+
+private:
+	// Private methods:
+	void		Release();
+
+	// Private variables:
+	AudioProcessor*	proc;
+	double			cutoff;
+	double			sampleRate;
+	int				frames;			// window size the estimator was prepared for
+	int				length;			// number of (most recent) samples analysed
+	int				minLag;			// shortest period considered, in samples
+	int				maxLag;			// longest period considered, in samples
+	Sample*			acf;			// autocorrelation r(lag), 0 .. maxLag
+	double*			nsdf;			// normalised square difference n(lag), 0 .. maxLag
+	int*			peaks;			// lags of the key maxima found in the current window
+};
\ No newline at end of file
@@ -0,0 +1,82 @@
+/**
+* @file		PitchEstimator.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The PitchEstimator class is the interface shared by the fundamental frequency
+* estimators (HPS, YIN, McLeod and target tuning) that the analysis pipeline
+* can be run with.
+**/
+
+#include "PitchEstimator.h"
+#include "HPSEstimator.h"
+#include "YINEstimator.h"
+#include "MPMEstimator.h"
+#include "TargetEstimator.h"
+
+// ****** Methods:
+// Construct the estimator for the given method ('harmonics' and 'refinement' only apply to HPS;
+// target tuning defaults to standard guitar tuning)
+PitchEstimator* PitchEstimator::Create(PitchMethod method, int harmonics, PitchRefinement refinement)
+{
+	switch (method) {
+	case PITCH_YIN:
+		return new YINEstimator();
+	case PITCH_MPM:
+		return new MPMEstimator();
+	case PITCH_TARGET:
+		return new TargetEstimator();
+	case PITCH_HPS:
+	default:
+		return new HPSEstimator(harmonics, refinement);
+	}
+}
+
+// Map a method name ("hps", "yin", "mpm" or "target") onto its PitchMethod; returns false if unknown
+bool PitchEstimator::ParseMethod(const std::string& name, PitchMethod* method)
+{
+	if (name == "hps") {
+		*method = PITCH_HPS;
+	}
+	else if (name == "yin") {
+		*method = PITCH_YIN;
+	}
+	else if (name == "mpm" || name == "mcleod") {
+		*method = PITCH_MPM;
+	}
+	else if (name == "target") {
+		*method = PITCH_TARGET;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+
+// The number of (most recent) samples a lag-domain estimator analyses: the smallest power of two
+// spanning two periods of the lowest frequency, capped at the full window. Returns 0 if the window
+// can't hold the longest lag.
+int PitchEstimator::LagWindow(int maxlag, int frames)
+{
+	int length = 1;
+	while (length < 2 * maxlag) {
+		length <<= 1;
+	}
+	length = std::min(length, frames);
+
+	return (maxlag < length) ? length : 0;
+}
+
+// Offset (-0.5 .. 0.5) of the vertex of the parabola through three equally spaced points
+double PitchEstimator::ParabolicOffset(double left, double centre, double right)
+{
+	double denominator = left - 2.0 * centre + right;
+	if (denominator == 0.0) {
+		return 0.0;
+	}
+
+	double offset = 0.5 * (left - right) / denominator;
+	return std::max(-0.5, std::min(0.5, offset));
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+/**
+* @file		PitchEstimator.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The PitchEstimator class is the interface shared by the fundamental frequency
+* estimators (HPS, YIN, McLeod and target tuning) that the analysis pipeline
+* can be run with.
+*/
+
+#pragma once
+
+// Local includes:
+#include "AudioProcessor.h"
+
+// Constants:
+#define PITCH_MAX_TARGETS 8				// target notes a target-tuning estimate can report on
+
+// Available pitch estimation algorithms
+enum PitchMethod
+{
+	PITCH_HPS,			// Harmonic Product Spectrum over the log spectrum (needs long windows)
+	PITCH_YIN,			// YIN cumulative mean normalised difference function
+	PITCH_MPM,			// McLeod Pitch Method normalised square difference function
+	PITCH_TARGET		// Goertzel detectors tuned to a known set of notes (no FFT)
+};
+
+// How the HPS estimator refines its peak bin into a frequency
+enum PitchRefinement
+{
+	REFINE_NONE,			// bin centre (+/- half a bin)
+	REFINE_QUADRATIC,		// parabola through the peak's magnitudes
+	REFINE_GAUSSIAN,		// parabola through the peak's log magnitudes
+	REFINE_PHASE_VOCODER	// Gaussian, then the peak's phase advance since the previous hop
+};
+
+// One analysis window, in both the time and frequency domains
+struct PitchInput
+{
+	const Sample*	samples;		// filtered (unwindowed) audio, oldest sample first
+	int				frames;			// number of samples
+	const Sample*	logspectrum;	// log10 magnitude spectrum of the windowed samples
+	int				bins;			// number of spectrum bins (frames / 2 + 1)
+	const Sample*	acf;			// autocorrelation of all the samples, if already computed (else NULL)
+	int				lags;			// number of lags in 'acf'
+	const SampleComplex*	transform;	// complex spectrum of the windowed samples (bins), if available
+	int				hop;			// samples since the previous window
+
+	PitchInput() {
+		samples = NULL;
+		frames = 0;
+		logspectrum = NULL;
+		bins = 0;
+		acf = NULL;
+		lags = 0;
+		transform = NULL;
+		hop = 0;
+	}
+};
+
+// The result of one estimate
+struct PitchEstimate
+{
+	double	frequency;				// fundamental frequency in Hz (0 if none was found)
+	double	confidence;				// 0 (none) .. 1 (certain)
+	int		target;					// target note being played (-1 if not tuning to targets)
+	int		targets;				// number of target notes reported on
+	double	targetCents[PITCH_MAX_TARGETS];	// each target note's deviation (cents)
+	double	targetLevel[PITCH_MAX_TARGETS];	// each target note's share of the energy, 0..1
+
+	PitchEstimate() {
+		frequency = 0.0;
+		confidence = 0.0;
+		target = -1;
+		targets = 0;
+	}
+};
+
+class PitchEstimator
+{
+public:
+	// Constructors/destructors:
+	virtual ~PitchEstimator() {}
+
+	// Methods:
+	// Allocate scratch space and plan transforms for windows of 'frames' samples; not real-time safe
+	virtual int		Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+							double maxfrequency, unsigned int plannerflags) = 0;
+	// Estimate the fundamental of one window; real-time safe once prepared. Called for every window,
+	// 'hop' samples after the last, until the next Reset
+	virtual bool	Estimate(const PitchInput& input, PitchEstimate* estimate) = 0;
+	virtual const char*	Name() const = 0;
+	// Report the autocorrelation (length of input, number of lags) Estimate would compute itself,
+	// so that the pipeline can provide it instead; false if the estimator doesn't use one
+	virtual bool	Autocorrelation(int* length, int* lags) const { return false; }
+	// Whether the pipeline needs to transform each window (the spectrum display aside, only for the
+	// estimator's sake)
+	virtual bool	NeedsSpectrum() const { return true; }
+	// Forget any state carried between windows (e.g. after a gap in the analysed stream)
+	virtual void	Reset() {}
+
+	static PitchEstimator*	Create(PitchMethod method, int harmonics, PitchRefinement refinement = REFINE_PHASE_VOCODER);
+	static bool				ParseMethod(const std::string& name, PitchMethod* method);
+
+protected:
+	// Protected methods:
+	static int		LagWindow(int maxlag, int frames);
+	static double	ParabolicOffset(double left, double centre, double right);
+};
\ No newline at end of file
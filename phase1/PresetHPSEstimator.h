@@ -0,0 +1,115 @@
+/**
+* @file		PresetHPSEstimator.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The PresetHPSEstimator class is an HPSEstimator specialised on one tuner
+* preset's configuration: the harmonic count and spectrum size are compile-time
+* constants, and the HPS is only evaluated over the preset's note range.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <algorithm>
+#include <cmath>
+
+// Local includes:
+#include "HPSEstimator.h"
+
+template <class Config>
+class PresetHPSEstimator : public HPSEstimator
+{
+public:
+	// Constants:
+	enum {
+		BINS = Config::FFT_SIZE / 2 + 1,
+		CANDIDATES = (BINS - 1) / Config::HARMONICS + 1	// bins whose every harmonic is inside the spectrum
+	};
+
+	// Constructors/destructors:
+	PresetHPSEstimator(PitchRefinement refinement = REFINE_PHASE_VOCODER)
+		: HPSEstimator(Config::HARMONICS, refinement) {
+		minBin = 1;
+		maxBin = CANDIDATES - 1;
+	}
+
+	// Methods:
+	// Only windows of the preset's FFT size are supported. The search range is derived from the
+	// preset's note range at the actual analysis rate (which a decimated stream may shift a little).
+	int Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+				double maxfrequency, unsigned int plannerflags) {
+		if (frames != Config::FFT_SIZE || HPSEstimator::Prepare(proc, frames, samplerate, minfrequency,
+				maxfrequency, plannerflags) != 0) {
+			return -1;
+		}
+
+		// one bin of slack either side, for the refinement to look at
+		double binSize = samplerate / (double)frames;
+		this->minBin = std::max(1, (int)floor(Config::MIN_FREQUENCY / binSize) - 1);
+		this->maxBin = std::min((int)CANDIDATES - 1, (int)ceil(Config::MAX_FREQUENCY / binSize) + 1);
+		if (this->minBin >= this->maxBin) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+protected:
+	// Protected methods:
+	// Log-domain HPS over the search range only, then the same octave check and confidence as
+	// AudioProcessor::LogHPS
+	int FindPeak(const Sample* logspectrum, double* confidence) {
+		// (each harmonic is the strongest bin within h/2 of j*h, as there)
+		for (int j = this->minBin; j <= this->maxBin; j += 1) {
+			Sample sum = logspectrum[j];
+			for (int h = 2; h <= Config::HARMONICS; h += 1) {
+				int last = std::min((int)BINS - 1, j * h + h / 2);
+				Sample strongest = logspectrum[j * h - h / 2];
+				for (int k = j * h - h / 2 + 1; k <= last; k += 1) {
+					strongest = std::max(strongest, logspectrum[k]);
+				}
+				sum += strongest;
+			}
+			this->hps[j] = sum;
+		}
+
+		int bin = this->minBin;
+		for (int j = this->minBin + 1; j <= this->maxBin; j += 1) {
+			if (this->hps[j] > this->hps[bin]) {
+				bin = j;
+			}
+		}
+
+		// attempt to fix octave misidentification errors (harmonics)
+		int fixBin = this->minBin;
+		int max = bin * 3 / 4;
+		for (int i = this->minBin + 1; i < max; i += 1) {
+			if (this->hps[i] > this->hps[fixBin]) {
+				fixBin = i;
+			}
+		}
+		if (abs(fixBin * 2 - bin) < 4 && this->hps[fixBin] - this->hps[bin] > log10(HPS_OCTAVE_RATIO)) {
+			bin = fixBin;
+		}
+
+		if (confidence != NULL) {
+			double total = 0.0;
+			for (int j = this->minBin; j <= this->maxBin; j += 1) {
+				double diff = this->hps[j] - this->hps[bin];
+				if (diff > -6.0) {
+					total += pow(10.0, diff);
+				}
+			}
+			*confidence = (total > 0.0) ? (1.0 / total) : 0.0;
+		}
+
+		return bin;
+	}
+
+private:
+	// Private variables:
+	int		minBin;					// search range, in bins
+	int		maxBin;
+	Sample	hps[CANDIDATES];
+};
\ No newline at end of file
@@ -0,0 +1,96 @@
+/**
+* @file		ProcessingContext.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The ProcessingContext class holds the pre-allocated scratch buffers and the
+* per-stream state used by the analysis pipeline, so that the real-time path
+* never touches the heap.
+**/
+
+#include "ProcessingContext.h"
+
+// ****** Constructors:
+ProcessingContext::ProcessingContext(int frames, int hop)
+{
+	this->frames = 0;
+	this->bins = 0;
+	this->filtered = NULL;
+	this->frame = NULL;
+	this->spectrum = NULL;
+	this->logspectrum = NULL;
+	this->transform = NULL;
+	this->acf = NULL;
+
+	this->Resize(frames, hop);
+}
+
+// ****** Destructor:
+ProcessingContext::~ProcessingContext()
+{
+	this->Release();
+}
+
+// ****** Methods:
+// (Re)allocate every scratch buffer for the given window and hop sizes. This allocates, so it must
+// only be called while the audio stream is stopped.
+int ProcessingContext::Resize(int frames, int hop)
+{
+	// a new stream starts from a clean filter state
+	this->filter.Reset();
+	this->decimator.Reset();
+
+	if (frames == this->frames && hop == this->history.GetHop()) {
+		this->history.Reset();
+		this->gate.Reset();
+		return 0;
+	}
+
+	this->Release();
+	if (frames <= 0 || this->history.Resize(frames, hop) != 0 || this->gate.Resize(frames, hop) != 0) {
+		return -1;
+	}
+
+	this->frames = frames;
+	this->bins = frames / 2 + 1;
+	this->filtered = (Sample*)FFTW(malloc)(sizeof(Sample) * frames);
+	this->frame = (Sample*)FFTW(malloc)(sizeof(Sample) * frames);
+	this->spectrum = (Sample*)FFTW(malloc)(sizeof(Sample) * this->bins);
+	this->logspectrum = (Sample*)FFTW(malloc)(sizeof(Sample) * this->bins);
+	this->transform = (SampleComplex*)FFTW(malloc)(sizeof(SampleComplex) * this->bins);
+	this->acf = (Sample*)FFTW(malloc)(sizeof(Sample) * frames);
+	if (this->filtered == NULL || this->frame == NULL || this->spectrum == NULL || this->logspectrum == NULL ||
+		this->transform == NULL || this->acf == NULL) {
+		this->Release();
+		return -1;
+	}
+
+	memset(this->filtered, 0, sizeof(Sample) * frames);
+	memset(this->frame, 0, sizeof(Sample) * frames);
+	memset(this->spectrum, 0, sizeof(Sample) * this->bins);
+	memset(this->logspectrum, 0, sizeof(Sample) * this->bins);
+	memset(this->transform, 0, sizeof(SampleComplex) * this->bins);
+	memset(this->acf, 0, sizeof(Sample) * frames);
+
+	return 0;
+}
+
+// Free the scratch buffers
+void ProcessingContext::Release()
+{
+	FFTW(free)(this->filtered);
+	FFTW(free)(this->frame);
+	FFTW(free)(this->spectrum);
+	FFTW(free)(this->logspectrum);
+	FFTW(free)(this->transform);
+	FFTW(free)(this->acf);
+
+	this->filtered = NULL;
+	this->frame = NULL;
+	this->spectrum = NULL;
+	this->logspectrum = NULL;
+	this->transform = NULL;
+	this->acf = NULL;
+	this->frames = 0;
+	this->bins = 0;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+/**
+* @file		ProcessingContext.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The ProcessingContext class holds the pre-allocated scratch buffers and the
+* per-stream state used by the analysis pipeline, so that the real-time path
+* never touches the heap.
+*/
+
+#pragma once
+
+// Local includes:
+#include "AudioProcessor.h"
+#include "SlidingWindow.h"
+#include "LowPassFilter.h"
+#include "Decimator.h"
+#include "SignalGate.h"
+
+class ProcessingContext
+{
+public:
+	// Constructors/destructors:
+	ProcessingContext(int frames, int hop);
+	~ProcessingContext();
+
+	// Methods:
+	int		Resize(int frames, int hop);
+
+	// Public variables:
+	int					frames;			// analysis window size the buffers are sized for
+	int					bins;			// number of spectrum bins an r2c transform of 'frames' yields
+	LowPassFilter		filter;			// continuous low-pass filter applied to the incoming stream
+	Decimator			decimator;		// anti-aliasing decimator, when the device runs above the analysis rate
+	Sample*				filtered;		// filtered input, on its way into the history
+	SlidingWindow		history;		// recent input, from which overlapping windows are taken
+	SignalGate			gate;			// level of each window, measured on the way into the history
+	Sample*				frame;			// the current analysis window, as read from the history
+	Sample*				spectrum;		// magnitude spectrum
+	Sample*				logspectrum;	// log10 of the magnitude spectrum
+	SampleComplex*		transform;		// complex spectrum (bins), for phase-based refinement
+	Sample*				acf;			// autocorrelation of the analysis window (up to 'frames' lags)
+
+private:
+	// Private methods:
+	void	Release();
+};
\ No newline at end of file
@@ -24,6 +24,13 @@ class RTTuner : public wxApp
 {
 public:
 	virtual bool OnInit();
+
+private:
+	bool HandleCommandLine();
+
+	PitchMethod pitchMethod;
+	TunerPresetId preset;
+	int channels;
 };
 
 // Launch main application:
@@ -33,11 +40,22 @@ IMPLEMENT_APP(RTTuner)
 // Class implementation:
 bool RTTuner::OnInit() 
 {
+	// handle any command-line switches that run without the GUI
+	this->pitchMethod = PITCH_METHOD;
+	this->preset = TUNER_PRESET;
+	this->channels = AUDIO_NUM_CHANNELS;
+	if (!this->HandleCommandLine()) {
+		return false;
+	}
+
 	// launch the GUI window
 	wxInitAllImageHandlers();
 	wxFrame *frame = new AudioVisualizer();
 	frame->Show(TRUE);
 	((AudioVisualizer*)frame)->WriteToGraphLog("Starting Audio functions...");
+	((AudioVisualizer*)frame)->SetPreset(this->preset);
+	((AudioVisualizer*)frame)->SetChannels(this->channels);
+	((AudioVisualizer*)frame)->SetPitchMethod(this->pitchMethod);
 
 	// start the audio functions
 	if (((AudioVisualizer*)frame)->InitializeAudio() == -1) {
@@ -47,4 +65,79 @@ bool RTTuner::OnInit()
 	((AudioVisualizer*)frame)->WriteToGraphLog("Audio stream started.");
 
 	return TRUE;
+}
+
+// Process command-line switches, returning true if the GUI should be launched. Currently supported:
+//   --generate-wisdom <size> [<size> ...]	pre-measure FFTW plans for the given sizes, then exit
+//   --pitch hps|yin|mpm|target				choose the pitch estimator for the live tuner
+//   --preset bass|guitar|voice				choose the instrument preset for the live tuner
+//   --channels <count>						capture and analyse this many input channels
+bool RTTuner::HandleCommandLine()
+{
+	bool generate = false;
+	std::vector<int> sizes;
+
+	for (int i = 1; i < this->argc; i += 1) {
+		wxString option(this->argv[i]);
+		if (option == wxT("--generate-wisdom")) {
+			// the sizes run up to the next switch, which may still be e.g. --preset
+			generate = true;
+			while (i + 1 < this->argc && !wxString(this->argv[i + 1]).StartsWith(wxT("--"))) {
+				i += 1;
+				long size;
+				if (!wxString(this->argv[i]).ToLong(&size) || size <= 0) {
+					std::cout << "Invalid FFT size: " << wxString(this->argv[i]).mb_str() << "\n";
+					return false;
+				}
+				sizes.push_back((int)size);
+			}
+			continue;
+		}
+
+		// the remaining switches take one argument each
+		std::string name = (i + 1 < this->argc) ? std::string(wxString(this->argv[i + 1]).Lower().mb_str()) : "";
+		if (option == wxT("--pitch")) {
+			PitchMethod method;
+			if (!PitchEstimator::ParseMethod(name, &method)) {
+				std::cout << "Unknown pitch estimator: " << name << " (expected hps, yin, mpm or target)\n";
+				return false;
+			}
+			this->pitchMethod = method;
+			i += 1;
+		}
+		else if (option == wxT("--preset")) {
+			TunerPresetId preset;
+			if (!TunerPreset::ParsePreset(name, &preset)) {
+				std::cout << "Unknown preset: " << name << " (expected bass, guitar or voice)\n";
+				return false;
+			}
+			this->preset = preset;
+			i += 1;
+		}
+		else if (option == wxT("--channels")) {
+			long channels;
+			if (!wxString(name).ToLong(&channels) || channels < 1) {
+				std::cout << "Invalid channel count: " << name << "\n";
+				return false;
+			}
+			this->channels = (int)channels;
+			i += 1;
+		}
+		else {
+			std::cout << "Ignoring unknown option: " << option.mb_str() << "\n";
+		}
+	}
+
+	// once every switch is in, so the default follows --preset wherever it was given
+	if (generate) {
+		if (sizes.empty()) {
+			// default to the size used by the live tuner
+			sizes.push_back(TunerPreset::GetSettings(this->preset).frames);
+		}
+
+		AudioCapturer::GenerateWisdom(sizes, AudioCapturer::DefaultWisdomFile());
+		return false;
+	}
+
+	return true;
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+/**
+* @file		SampleFormat.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The sample format used throughout the analysis pipeline. By default samples
+* are doubles; defining ANALYSIS_FLOAT32 switches the capture stream, every
+* buffer, the FFTW plans (fftwf_*, which needs libfftw3f-3.lib linked instead
+* of libfftw3-3.lib) and the SIMD kernels over to single precision. The
+* "Release Float32" configurations define it, and "rt-batch --accuracy --track
+* accuracy-track.csv" checks that build's readings against the double ones.
+*/
+
+#pragma once
+//#define ANALYSIS_FLOAT32	// single-precision pipeline
+
+// Local includes:
+#include "FFTW\fftw3.h"
+#include "SimdSupport.h"
+
+#ifdef ANALYSIS_FLOAT32
+typedef float			Sample;
+typedef fftwf_complex	SampleComplex;
+typedef fftwf_plan		SamplePlan;
+#define FFTW(name) fftwf_##name				// the FFTW API for the sample precision
+#define AUDIO_SAMPLE_FORMAT RTAUDIO_FLOAT32	// RtAudio stream format
+#else
+typedef double			Sample;
+typedef fftw_complex	SampleComplex;
+typedef fftw_plan		SamplePlan;
+#define FFTW(name) fftw_##name
+#define AUDIO_SAMPLE_FORMAT RTAUDIO_FLOAT64
+#endif
+
+// Sum of squares and largest magnitude of a run of samples, gathered by the filter kernels as they
+// write their output so that the silence gate doesn't need a pass of its own
+struct SampleLevel
+{
+	double	energy;
+	double	peak;
+
+	SampleLevel() {
+		energy = 0.0;
+		peak = 0.0;
+	}
+};
+
+// SSE2 vectors of samples (4 floats or 2 doubles), for kernels that are the same in either precision
+#ifdef SIMD_HAVE_SSE2
+#ifdef ANALYSIS_FLOAT32
+typedef __m128 SampleVector;
+#define SAMPLE_LANES 4
+inline SampleVector	SampleLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void			SampleStore(float* p, SampleVector v) { _mm_storeu_ps(p, v); }
+inline SampleVector	SampleAdd(SampleVector a, SampleVector b) { return _mm_add_ps(a, b); }
+inline SampleVector	SampleMul(SampleVector a, SampleVector b) { return _mm_mul_ps(a, b); }
+inline SampleVector	SampleZero() { return _mm_setzero_ps(); }
+inline float		SampleSum(SampleVector v) {
+	float lanes[4];
+	_mm_storeu_ps(lanes, v);
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+#else
+typedef __m128d SampleVector;
+#define SAMPLE_LANES 2
+inline SampleVector	SampleLoad(const double* p) { return _mm_loadu_pd(p); }
+inline void			SampleStore(double* p, SampleVector v) { _mm_storeu_pd(p, v); }
+inline SampleVector	SampleAdd(SampleVector a, SampleVector b) { return _mm_add_pd(a, b); }
+inline SampleVector	SampleMul(SampleVector a, SampleVector b) { return _mm_mul_pd(a, b); }
+inline SampleVector	SampleZero() { return _mm_setzero_pd(); }
+inline double		SampleSum(SampleVector v) {
+	double lanes[2];
+	_mm_storeu_pd(lanes, v);
+	return lanes[0] + lanes[1];
+}
+#endif
+#endif
\ No newline at end of file
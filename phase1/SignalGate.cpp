@@ -0,0 +1,152 @@
+/**
+* @file		SignalGate.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The SignalGate class keeps the RMS and peak level of each analysis window,
+* from the per-hop measurements the filter kernels make as the samples stream
+* past, and decides (with hysteresis) whether the window holds enough signal
+* to be worth analysing.
+**/
+
+#include "SignalGate.h"
+
+// Standard includes:
+#include <cmath>
+#include <algorithm>
+
+// ****** Constructors:
+SignalGate::SignalGate()
+{
+	hop = 0;
+	pending = 0;
+	slot = 0;
+	enabled = true;
+	open = false;
+	openLevel = GATE_OPEN_LEVEL;
+	closeLevel = GATE_CLOSE_LEVEL;
+	level = GATE_SILENCE_LEVEL;
+	peak = GATE_SILENCE_LEVEL;
+}
+
+// ****** Methods:
+// Size the per-hop measurements for windows of 'window' samples, advancing 'hop' samples at a time
+// (a window that isn't a whole number of hops is measured over the hops that cover it). This
+// allocates, so it must not be called from the audio thread.
+int SignalGate::Resize(int window, int hop)
+{
+	if (window <= 0 || hop <= 0 || hop > window) {
+		return -1;
+	}
+
+	// one entry per hop of the window, plus the hop being filled
+	int slots = (window + hop - 1) / hop + 1;
+	this->hop = hop;
+	this->energy.assign(slots, 0.0);
+	this->peaks.assign(slots, 0.0);
+	this->Reset();
+
+	return 0;
+}
+
+// Forget the measured levels and close the gate
+void SignalGate::Reset()
+{
+	std::fill(this->energy.begin(), this->energy.end(), 0.0);
+	std::fill(this->peaks.begin(), this->peaks.end(), 0.0);
+	this->pending = 0;
+	this->slot = 0;
+	this->open = false;
+	this->level = GATE_SILENCE_LEVEL;
+	this->peak = GATE_SILENCE_LEVEL;
+}
+
+// Enable or disable gating (a disabled gate passes every window, but still measures levels)
+void SignalGate::SetEnabled(bool enable)
+{
+	this->enabled = enable;
+}
+
+// Set the levels (dBFS) at which the gate opens and closes; the close level should be the lower of
+// the two, so that a note decaying around the threshold doesn't flicker in and out. A closed gate
+// opens on the window's RMS level; an open one also stays open while any peak in the window still
+// reaches the open level, so a plucked note's fading transients keep it from cutting out early.
+void SignalGate::SetThresholds(double openlevel, double closelevel)
+{
+	this->openLevel = openlevel;
+	this->closeLevel = std::min(openlevel, closelevel);
+}
+
+// Account for 'count' samples on their way into the analysis history, whose level was measured as
+// they were filtered. The samples must not run past the end of the current hop (see GetRemaining).
+void SignalGate::Add(int count, const SampleLevel& level)
+{
+	if (this->hop == 0 || count <= 0) {
+		return;
+	}
+
+	this->energy[this->slot] += level.energy;
+	this->peaks[this->slot] = std::max(this->peaks[this->slot], level.peak);
+	this->pending += count;
+
+	// start the next hop, overwriting the oldest
+	if (this->pending >= this->hop) {
+		this->pending = 0;
+		this->slot = (this->slot + 1) % (int)this->energy.size();
+		this->energy[this->slot] = 0.0;
+		this->peaks[this->slot] = 0.0;
+	}
+}
+
+// Samples still to come before the current hop is complete
+int SignalGate::GetRemaining() const
+{
+	return this->hop - this->pending;
+}
+
+// Judge the window that has just become ready, returning whether it should be analysed
+bool SignalGate::Update()
+{
+	// every complete hop (the one being filled is not part of this window)
+	double total = 0.0;
+	double largest = 0.0;
+	for (int i = 0; i < (int)this->energy.size(); i += 1) {
+		if (i != this->slot) {
+			total += this->energy[i];
+			largest = std::max(largest, this->peaks[i]);
+		}
+	}
+
+	int samples = ((int)this->energy.size() - 1) * this->hop;
+	double rms = (samples > 0) ? sqrt(total / samples) : 0.0;
+	this->level = (rms > 0.0) ? std::max(GATE_SILENCE_LEVEL, 20.0 * log10(rms)) : GATE_SILENCE_LEVEL;
+	this->peak = (largest > 0.0) ? std::max(GATE_SILENCE_LEVEL, 20.0 * log10(largest)) : GATE_SILENCE_LEVEL;
+
+	// hysteresis: a closed gate needs the higher level to open
+	if (this->open) {
+		this->open = (this->level >= this->closeLevel || this->peak >= this->openLevel);
+	}
+	else {
+		this->open = (this->level >= this->openLevel);
+	}
+
+	return (this->open || !this->enabled);
+}
+
+// Whether the last window judged was above the threshold
+bool SignalGate::IsOpen() const
+{
+	return this->open;
+}
+
+// RMS level of the last window judged (dBFS)
+double SignalGate::GetLevel() const
+{
+	return this->level;
+}
+
+// Peak level of the last window judged (dBFS)
+double SignalGate::GetPeak() const
+{
+	return this->peak;
+}
\ No newline at end of file
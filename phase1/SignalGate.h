@@ -0,0 +1,56 @@
+/**
+* @file		SignalGate.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The SignalGate class keeps the RMS and peak level of each analysis window,
+* from the per-hop measurements the filter kernels make as the samples stream
+* past, and decides (with hysteresis) whether the window holds enough signal
+* to be worth analysing.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <vector>
+
+// Local includes:
+#include "SampleFormat.h"
+
+// Constants:
+#define GATE_OPEN_LEVEL -50.0			// RMS level (dBFS) at which a closed gate opens (default: -50)
+#define GATE_CLOSE_LEVEL -56.0			// RMS level (dBFS) below which an open gate closes (default: -56)
+#define GATE_SILENCE_LEVEL -200.0		// level reported for digital silence
+
+class SignalGate
+{
+public:
+	// Constructors/destructors:
+	SignalGate();
+
+	// Methods:
+	int		Resize(int window, int hop);
+	void	Reset();
+	void	SetEnabled(bool enable);
+	void	SetThresholds(double openlevel, double closelevel);
+	void	Add(int count, const SampleLevel& level);
+	int		GetRemaining() const;
+	bool	Update();
+	bool	IsOpen() const;
+	double	GetLevel() const;
+	double	GetPeak() const;
+
+private:
+	// Private variables:
+	int					hop;
+	int					pending;		// samples already in the newest hop
+	int					slot;			// the entry of the hop being filled
+	std::vector<double>	energy;			// sum of squares of each of the window's hops (circular)
+	std::vector<double>	peaks;			// largest magnitude in each of the window's hops
+	bool				enabled;
+	bool				open;
+	double				openLevel;
+	double				closeLevel;
+	double				level;			// RMS level of the last window judged (dBFS)
+	double				peak;			// peak level of the last window judged (dBFS)
+};
\ No newline at end of file
@@ -0,0 +1,133 @@
+/**
+* @file		SignalSynth.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The SignalSynth class generates the synthetic test signals the accuracy
+* check plays through the analysis chain: sustained and detuned harmonic
+* notes, plucked strings, sweeps, notes whose fundamental is weaker than its
+* octave, and noise. Every signal is deterministic, so runs can be compared.
+**/
+
+#include "SignalSynth.h"
+
+// ****** Constructors:
+SignalSynth::SignalSynth(double samplerate, unsigned int seed)
+{
+	this->sampleRate = samplerate;
+	this->seed = seed;
+}
+
+// ****** Methods:
+// A steady note with SYNTH_HARMONICS partials falling off as 1/k
+void SignalSynth::Note(Sample* out, int count, double frequency)
+{
+	double norm = 0.0;
+	for (int k = 1; k <= SYNTH_HARMONICS; k += 1) {
+		norm += 1.0 / k;
+	}
+
+	for (int i = 0; i < count; i += 1) {
+		double phase = 2 * M_PI * frequency * i / this->sampleRate;
+		double value = 0.0;
+		for (int k = 1; k <= SYNTH_HARMONICS; k += 1) {
+			if (k * frequency < this->sampleRate / 2) {
+				value += sin(k * phase) / k;
+			}
+		}
+		out[i] = (Sample)(SYNTH_LEVEL * value / norm);
+	}
+}
+
+// A plucked string: stretched (slightly sharp) partials, each decaying faster than the one below,
+// from a pluck a fifth of the way along the string
+void SignalSynth::Pluck(Sample* out, int count, double frequency)
+{
+	double amplitude[SYNTH_HARMONICS + 1];
+	double omega[SYNTH_HARMONICS + 1];
+	double norm = 0.0;
+	for (int k = 1; k <= SYNTH_HARMONICS; k += 1) {
+		amplitude[k] = fabs(sin(M_PI * k / 5.0)) / (k * k);
+		omega[k] = 2 * M_PI * k * frequency * sqrt(1.0 + SYNTH_INHARMONICITY * k * k) / this->sampleRate;
+		if (omega[k] >= M_PI) {
+			amplitude[k] = 0.0;
+		}
+		norm += amplitude[k];
+	}
+
+	for (int i = 0; i < count; i += 1) {
+		double t = i / this->sampleRate;
+		double value = 0.0;
+		for (int k = 1; k <= SYNTH_HARMONICS; k += 1) {
+			value += amplitude[k] * exp(-SYNTH_PLUCK_DECAY * k * t) * sin(omega[k] * i);
+		}
+		out[i] = (Sample)(SYNTH_LEVEL * value / norm);
+	}
+}
+
+// A harmonic note gliding exponentially (at a constant rate in cents) from one frequency to another
+void SignalSynth::Sweep(Sample* out, int count, double from, double to)
+{
+	double norm = 0.0;
+	for (int k = 1; k <= SYNTH_HARMONICS; k += 1) {
+		norm += 1.0 / k;
+	}
+
+	double phase = 0.0;
+	for (int i = 0; i < count; i += 1) {
+		double frequency = this->SweepFrequency(i, count, from, to);
+		double value = 0.0;
+		for (int k = 1; k <= SYNTH_HARMONICS; k += 1) {
+			if (k * frequency < this->sampleRate / 2) {
+				value += sin(k * phase) / k;
+			}
+		}
+		out[i] = (Sample)(SYNTH_LEVEL * value / norm);
+		phase = fmod(phase + 2 * M_PI * frequency / this->sampleRate, 2 * M_PI);
+	}
+}
+
+// A note whose fundamental is much weaker than its second and third harmonics (as from a small
+// speaker, or some voices), which tempts estimators an octave up
+void SignalSynth::OctaveAmbiguous(Sample* out, int count, double frequency)
+{
+	static const double amplitude[] = { 0.0, 0.1, 1.0, 0.6, 0.4, 0.2 };
+	double norm = 0.0;
+	for (int k = 1; k <= 5; k += 1) {
+		norm += amplitude[k];
+	}
+
+	for (int i = 0; i < count; i += 1) {
+		double phase = 2 * M_PI * frequency * i / this->sampleRate;
+		double value = 0.0;
+		for (int k = 1; k <= 5; k += 1) {
+			if (k * frequency < this->sampleRate / 2) {
+				value += amplitude[k] * sin(k * phase);
+			}
+		}
+		out[i] = (Sample)(SYNTH_LEVEL * value / norm);
+	}
+}
+
+// Add white noise of an RMS level (linear)
+void SignalSynth::AddNoise(Sample* out, int count, double level)
+{
+	// uniform noise in -1..1 has an RMS of 1 / sqrt(3)
+	double scale = level * sqrt(3.0);
+	for (int i = 0; i < count; i += 1) {
+		out[i] += (Sample)(scale * (2.0 * this->Random() - 1.0));
+	}
+}
+
+// The frequency a sweep of 'count' samples has reached at a sample
+double SignalSynth::SweepFrequency(int sample, int count, double from, double to) const
+{
+	return from * pow(to / from, (double)sample / count);
+}
+
+// The next number of a linear congruential generator, in 0..1
+double SignalSynth::Random()
+{
+	this->seed = this->seed * 1664525 + 1013904223;
+	return (this->seed >> 8) / 16777216.0;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+/**
+* @file		SignalSynth.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The SignalSynth class generates the synthetic test signals the accuracy
+* check plays through the analysis chain: sustained and detuned harmonic
+* notes, plucked strings, sweeps, notes whose fundamental is weaker than its
+* octave, and noise. Every signal is deterministic, so runs can be compared.
+*/
+
+#pragma once
+
+// Local includes:
+#include "AudioProcessor.h"
+
+// Constants:
+#define SYNTH_HARMONICS 8				// partials of the harmonic and plucked notes (default: 8)
+#define SYNTH_INHARMONICITY 0.0001		// stiffness of the plucked string model, B in f_k = k f sqrt(1 + B k^2)
+#define SYNTH_PLUCK_DECAY 1.5			// decay rate of a plucked string's fundamental (1/s); partial k decays k times as fast
+#define SYNTH_LEVEL 0.5					// peak amplitude of the signals
+
+class SignalSynth
+{
+public:
+	// Constructors/destructors:
+	SignalSynth(double samplerate, unsigned int seed = 1);
+
+	// Methods:
+	void	Note(Sample* out, int count, double frequency);
+	void	Pluck(Sample* out, int count, double frequency);
+	void	Sweep(Sample* out, int count, double from, double to);
+	void	OctaveAmbiguous(Sample* out, int count, double frequency);
+	void	AddNoise(Sample* out, int count, double level);
+	double	SweepFrequency(int sample, int count, double from, double to) const;
+
+private:
+	// Private methods:
+	double	Random();
+
+	// Private variables:
+	double			sampleRate;
+	unsigned int	seed;
+};
\ No newline at end of file
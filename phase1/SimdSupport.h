@@ -0,0 +1,35 @@
+/**
+* @file		SimdSupport.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* Compile-time and run-time detection of the SIMD instruction sets used by
+* the DSP kernels. Kernels are compiled whenever the target architecture can
+* have them, and chosen at run time based on what the CPU reports.
+*/
+
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_HAVE_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Runtime check for SSE2 support
+inline bool SimdHasSSE2()
+{
+#if !defined(SIMD_HAVE_SSE2)
+	return false;
+#elif defined(_M_X64) || defined(__x86_64__)
+	return true;	// part of the x86-64 baseline
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	return __builtin_cpu_supports("sse2") != 0;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+/**
+* @file		SlidingWindow.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The SlidingWindow class keeps a circular history of the most recent samples
+* and signals every 'hop' samples that a new (overlapping) analysis window is
+* ready, so the update rate is independent of the window size.
+**/
+
+#include "SlidingWindow.h"
+
+// Standard includes:
+#include <cstring>
+#include <algorithm>
+
+// ****** Constructors:
+SlidingWindow::SlidingWindow()
+{
+	window = 0;
+	hop = 0;
+	pos = 0;
+	filled = 0;
+	pending = 0;
+}
+
+// ****** Methods:
+// Set the window and hop sizes (e.g. a hop of window/4 gives 75% overlap). This allocates, so it
+// must not be called from the audio thread.
+int SlidingWindow::Resize(int window, int hop)
+{
+	if (window <= 0 || hop <= 0 || hop > window) {
+		return -1;
+	}
+
+	this->window = window;
+	this->hop = hop;
+	this->history.assign(window, 0.0);
+	this->Reset();
+
+	return 0;
+}
+
+// Forget all buffered samples
+void SlidingWindow::Reset()
+{
+	std::fill(this->history.begin(), this->history.end(), 0.0);
+	this->pos = 0;
+	this->filled = 0;
+	this->pending = 0;
+}
+
+// Pass over the current window without reading it, and start counting towards the next hop
+void SlidingWindow::SkipFrame()
+{
+	this->pending = 0;
+}
+
+// Append samples to the history. Stops early as soon as a window becomes ready, so that no window
+// is skipped; returns the number of samples consumed.
+int SlidingWindow::Push(const Sample* data, int count)
+{
+	if (this->window == 0 || this->FrameReady()) {
+		return 0;
+	}
+
+	int n = std::min(count, this->GetNeeded());
+
+	// write in (at most) two pieces around the end of the circular buffer
+	int first = std::min(n, this->window - this->pos);
+	memcpy(&this->history[this->pos], data, sizeof(Sample) * first);
+	memcpy(&this->history[0], data + first, sizeof(Sample) * (n - first));
+
+	this->pos = (this->pos + n) % this->window;
+	this->filled = std::min(this->filled + n, this->window);
+	this->pending += n;
+
+	return n;
+}
+
+// Whether a new analysis window is waiting to be read
+bool SlidingWindow::FrameReady() const
+{
+	return (this->window > 0 && this->filled == this->window && this->pending >= this->hop);
+}
+
+// Samples still to be pushed before the next window is ready (0 while one is waiting)
+int SlidingWindow::GetNeeded() const
+{
+	if (this->window == 0 || this->FrameReady()) {
+		return 0;
+	}
+
+	// the first window needs a full history, later ones just a hop's worth of new samples
+	return (this->filled < this->window) ? (this->window - this->filled) : (this->hop - this->pending);
+}
+
+// Copy out the current window, oldest sample first, and start counting towards the next hop
+void SlidingWindow::ReadFrame(Sample* out)
+{
+	int tail = this->window - this->pos;
+	memcpy(out, &this->history[this->pos], sizeof(Sample) * tail);
+	memcpy(out + tail, &this->history[0], sizeof(Sample) * this->pos);
+
+	this->pending = 0;
+}
\ No newline at end of file
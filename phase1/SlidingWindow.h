@@ -0,0 +1,44 @@
+/**
+* @file		SlidingWindow.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The SlidingWindow class keeps a circular history of the most recent samples
+* and signals every 'hop' samples that a new (overlapping) analysis window is
+* ready, so the update rate is independent of the window size.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <vector>
+
+// Local includes:
+#include "SampleFormat.h"
+
+class SlidingWindow
+{
+public:
+	// Constructors/destructors:
+	SlidingWindow();
+
+	// Methods:
+	int		Resize(int window, int hop);
+	void	Reset();
+	int		Push(const Sample* data, int count);
+	bool	FrameReady() const;
+	int		GetNeeded() const;
+	void	ReadFrame(Sample* out);
+	void	SkipFrame();
+	int		GetWindow() const { return window; }
+	int		GetHop() const { return hop; }
+
+private:
+	// Private variables:
+	std::vector<Sample>	history;	// circular sample history, 'window' samples long
+	int					window;		// analysis window size
+	int					hop;		// samples between consecutive windows
+	int					pos;		// next write position in the history
+	int					filled;		// number of valid samples in the history
+	int					pending;	// samples received since the last window was read
+};
\ No newline at end of file
@@ -0,0 +1,144 @@
+/**
+* @file		SpscRing.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The SpscRing class is a fixed-capacity, lock-free ring buffer for passing
+* data from exactly one producer thread to exactly one consumer thread.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+// Constants:
+#define SPSC_CACHE_LINE 64				// padding between the producer and consumer indices
+
+template <typename T>
+class SpscRing
+{
+public:
+	// Constructors/destructors:
+	// (capacity is rounded up to a power of two; all storage is allocated here)
+	SpscRing(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity) {
+			size <<= 1;
+		}
+
+		slots.resize(size);
+		mask = size - 1;
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+	}
+
+	// Methods:
+	// -- producer side
+	// Get the next free slot to fill in place, or NULL if the ring is full
+	T* BeginWrite() {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= slots.size()) {
+			return NULL;
+		}
+
+		return &slots[h & mask];
+	}
+
+	// Publish the slot returned by BeginWrite to the consumer
+	void CommitWrite() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Copy an item into the ring, returning false (and dropping it) if the ring is full
+	bool Push(const T& item) {
+		T* slot = this->BeginWrite();
+		if (slot == NULL) {
+			return false;
+		}
+
+		*slot = item;
+		this->CommitWrite();
+		return true;
+	}
+
+	// Copy up to 'count' items into the ring, returning how many fit
+	size_t Write(const T* items, size_t count) {
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t space = slots.size() - (h - tail.load(std::memory_order_acquire));
+		if (count > space) {
+			count = space;
+		}
+
+		for (size_t i = 0; i < count; i += 1) {
+			slots[(h + i) & mask] = items[i];
+		}
+
+		head.store(h + count, std::memory_order_release);
+		return count;
+	}
+
+	// -- consumer side
+	// Get the oldest unread item without removing it, or NULL if the ring is empty
+	const T* Front() {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) {
+			return NULL;
+		}
+
+		return &slots[t & mask];
+	}
+
+	// Release the item returned by Front back to the producer
+	void PopFront() {
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Copy out the oldest item, returning false if the ring is empty
+	bool Pop(T& item) {
+		const T* slot = this->Front();
+		if (slot == NULL) {
+			return false;
+		}
+
+		item = *slot;
+		this->PopFront();
+		return true;
+	}
+
+	// Copy out up to 'count' of the oldest items, returning how many were available
+	size_t Read(T* items, size_t count) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		size_t available = head.load(std::memory_order_acquire) - t;
+		if (count > available) {
+			count = available;
+		}
+
+		for (size_t i = 0; i < count; i += 1) {
+			items[i] = slots[(t + i) & mask];
+		}
+
+		tail.store(t + count, std::memory_order_release);
+		return count;
+	}
+
+	// -- either side
+	size_t	Size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+	size_t	Capacity() const { return slots.size(); }
+
+private:
+	// Private variables:
+	std::vector<T>		slots;
+	size_t				mask;
+	char				pad0[SPSC_CACHE_LINE];
+	std::atomic<size_t>	head;		// next slot to write (owned by the producer)
+	char				pad1[SPSC_CACHE_LINE];
+	std::atomic<size_t>	tail;		// next slot to read (owned by the consumer)
+	char				pad2[SPSC_CACHE_LINE];
+
+	// non-copyable
+	SpscRing(const SpscRing&);
+	SpscRing& operator=(const SpscRing&);
+};
\ No newline at end of file
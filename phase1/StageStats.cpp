@@ -0,0 +1,225 @@
+/**
+* @file		StageStats.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The StageStats class records how long each stage of the audio path takes,
+* in log-linear histograms, along with counts of overflows and dropped data.
+* Each instance has a single writer (the thread running the callback or one
+* pipeline), which only ever loads and stores its own 32-bit counters, so
+* recording takes no locks and no interlocked instructions; any thread may
+* take a snapshot at the same time.
+**/
+
+#include "StageStats.h"
+
+// Standard includes:
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+// Platform includes (for the clocks):
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+#if defined(STAGE_CLOCK_TSC) && !defined(_MSC_VER)
+#include <x86intrin.h>
+#endif
+
+// Clock ticks to ns (0 until calibrated)
+double StageStats::nsPerTick = 0.0;
+
+// A precise wall clock (ns), to calibrate the timestamp counter against; VS2013's steady_clock only
+// ticks every millisecond or so
+static double WallClock()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, count;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&count);
+	return count.QuadPart * (1e9 / frequency.QuadPart);
+#else
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// ****** Constructors:
+StatsSnapshot::StatsSnapshot()
+{
+	this->Clear();
+}
+
+StageStats::StageStats()
+{
+	for (int s = 0; s < STAGE_COUNT; s += 1) {
+		for (int b = 0; b < STAGE_BUCKETS; b += 1) {
+			this->buckets[s][b].store(0);
+		}
+		this->max[s].store(0);
+	}
+	for (int c = 0; c < COUNTER_COUNT; c += 1) {
+		this->counters[c].store(0);
+	}
+
+	if (nsPerTick == 0.0) {
+		Calibrate();
+	}
+}
+
+// ****** Methods:
+// Empty a snapshot, ready to add StageStats to
+void StatsSnapshot::Clear()
+{
+	memset(this->buckets, 0, sizeof(this->buckets));
+	memset(this->max, 0, sizeof(this->max));
+	memset(this->counters, 0, sizeof(this->counters));
+}
+
+// Summarise one stage's histogram: each value is taken as the middle of its bucket
+StageSummary StatsSnapshot::Summarize(TimedStage stage) const
+{
+	StageSummary summary;
+	const unsigned long long* counts = this->buckets[stage];
+	double sum = 0.0;
+	for (int b = 0; b < STAGE_BUCKETS; b += 1) {
+		summary.count += counts[b];
+		sum += counts[b] * 0.5 * (StageStats::BucketStart(b) + StageStats::BucketStart(b + 1));
+	}
+	if (summary.count == 0) {
+		return summary;
+	}
+
+	summary.mean = sum / summary.count;
+	summary.max = (double)this->max[stage];
+	unsigned long long seen = 0;
+	for (int b = 0; b < STAGE_BUCKETS; b += 1) {
+		double middle = std::min(summary.max, 0.5 * (StageStats::BucketStart(b) + StageStats::BucketStart(b + 1)));
+		if (seen < summary.count * 0.5 && seen + counts[b] >= summary.count * 0.5) {
+			summary.p50 = middle;
+		}
+		if (seen < summary.count * 0.99 && seen + counts[b] >= summary.count * 0.99) {
+			summary.p99 = middle;
+		}
+		seen += counts[b];
+	}
+
+	return summary;
+}
+
+// Read the clock (in ticks; see Record)
+unsigned long long StageStats::Now()
+{
+#if defined(STAGE_CLOCK_TSC)
+	return __rdtsc();
+#elif defined(_WIN32)
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return count.QuadPart;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Record how long a stage took, between two readings of Now. Only the owning thread may call this.
+void StageStats::Record(TimedStage stage, unsigned long long start, unsigned long long end)
+{
+	double ns = (end > start) ? (end - start) * nsPerTick : 0.0;
+	unsigned int value = (unsigned int)std::min(ns, 4294967295.0);
+
+	std::atomic<unsigned int>& bucket = this->buckets[stage][Bucket(value)];
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	if (value > this->max[stage].load(std::memory_order_relaxed)) {
+		this->max[stage].store(value, std::memory_order_relaxed);
+	}
+}
+
+// Add to one of the counters. Only the owning thread may call this.
+void StageStats::Count(StageCounter counter, unsigned int amount)
+{
+	std::atomic<unsigned int>& value = this->counters[counter];
+	value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Add these statistics to a snapshot (from any thread; a stage may be caught mid-update, but each
+// count is read whole)
+void StageStats::AddTo(StatsSnapshot* snapshot) const
+{
+	for (int s = 0; s < STAGE_COUNT; s += 1) {
+		for (int b = 0; b < STAGE_BUCKETS; b += 1) {
+			snapshot->buckets[s][b] += this->buckets[s][b].load(std::memory_order_relaxed);
+		}
+		snapshot->max[s] = std::max(snapshot->max[s], (unsigned long long)this->max[s].load(std::memory_order_relaxed));
+	}
+	for (int c = 0; c < COUNTER_COUNT; c += 1) {
+		snapshot->counters[c] += this->counters[c].load(std::memory_order_relaxed);
+	}
+}
+
+// Get a stage's name, for display
+const char* StageStats::StageName(TimedStage stage)
+{
+	static const char* names[] = { "callback", "filter", "transform", "log spectrum", "constant-Q", "estimate", "handoff" };
+	return (stage >= 0 && stage < STAGE_COUNT) ? names[stage] : "";
+}
+
+// Get a counter's name, for display
+const char* StageStats::CounterName(StageCounter counter)
+{
+	static const char* names[] = { "input overflows", "FIFO samples dropped", "results dropped" };
+	return (counter >= 0 && counter < COUNTER_COUNT) ? names[counter] : "";
+}
+
+// Find the bucket a duration (ns) falls in: exact below 2^STAGE_SUB_BITS, then 2^STAGE_SUB_BITS
+// equal steps per power of two
+int StageStats::Bucket(unsigned long long ns)
+{
+	const unsigned long long steps = 1ULL << STAGE_SUB_BITS;
+	if (ns < steps) {
+		return (int)ns;
+	}
+
+	int top = STAGE_SUB_BITS;
+	while (top < 31 && (ns >> (top + 1)) != 0) {
+		top += 1;
+	}
+	int bucket = ((top - STAGE_SUB_BITS + 1) << STAGE_SUB_BITS) + (int)((ns >> (top - STAGE_SUB_BITS)) & (steps - 1));
+	return std::min(bucket, STAGE_BUCKETS - 1);
+}
+
+// The shortest duration (ns) in a bucket
+double StageStats::BucketStart(int bucket)
+{
+	const int steps = 1 << STAGE_SUB_BITS;
+	if (bucket < steps) {
+		return bucket;
+	}
+
+	int top = (bucket >> STAGE_SUB_BITS) + STAGE_SUB_BITS - 1;
+	return (double)(steps + (bucket & (steps - 1))) * pow(2.0, top - STAGE_SUB_BITS);
+}
+
+// Measure the clock's tick rate. The timestamp counter is compared with the wall clock over a short
+// sleep (invariant TSCs, on every CPU since about 2008, tick at a constant rate).
+void StageStats::Calibrate()
+{
+#if defined(STAGE_CLOCK_TSC)
+	double wallStart = WallClock();
+	unsigned long long ticksStart = Now();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	double wallEnd = WallClock();
+	unsigned long long ticksEnd = Now();
+	nsPerTick = (wallEnd - wallStart) / (double)(ticksEnd - ticksStart);
+#elif defined(_WIN32)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	nsPerTick = 1e9 / frequency.QuadPart;
+#else
+	nsPerTick = 1.0;
+#endif
+}
\ No newline at end of file
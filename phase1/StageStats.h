@@ -0,0 +1,106 @@
+/**
+* @file		StageStats.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The StageStats class records how long each stage of the audio path takes,
+* in log-linear histograms, along with counts of overflows and dropped data.
+* Each instance has a single writer (the thread running the callback or one
+* pipeline), which only ever loads and stores its own 32-bit counters, so
+* recording takes no locks and no interlocked instructions; any thread may
+* take a snapshot at the same time.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <atomic>
+
+// Local includes:
+#include "SimdSupport.h"
+
+// Constants:
+#define STAGE_SUB_BITS 2				// linear steps per power of two, as bits (default: 2, so within 25%)
+#define STAGE_BUCKETS (32 << STAGE_SUB_BITS)	// buckets covering 0 to 2^32 ns
+#ifdef SIMD_HAVE_SSE2
+#define STAGE_CLOCK_TSC					// time with the CPU's timestamp counter rather than steady_clock
+#endif
+
+// The stages of the audio path that are timed
+enum TimedStage
+{
+	STAGE_CALLBACK,			// the whole device callback
+	STAGE_FILTER,			// low-pass filter or decimator (and the gate's level measurement)
+	STAGE_TRANSFORM,		// window, FFT and magnitude spectrum (applied in a single pass by PerformFFT)
+	STAGE_LOG_SPECTRUM,		// log magnitude spectrum
+	STAGE_CONSTANT_Q,		// constant-Q and chroma views, for display
+	STAGE_ESTIMATE,			// pitch estimation (HPS, YIN, MPM or target)
+	STAGE_HANDOFF,			// publishing the result to the GUI
+	STAGE_COUNT
+};
+
+// Events that are counted
+enum StageCounter
+{
+	COUNTER_INPUT_OVERFLOWS,	// callbacks RtAudio flagged with an input overflow
+	COUNTER_FIFO_DROPS,			// samples the DSP workers' FIFOs had no room for
+	COUNTER_FRAMES_DROPPED,		// results dropped because the GUI had fallen behind
+	COUNTER_COUNT
+};
+
+// A summary of one stage's timings
+struct StageSummary
+{
+	unsigned long long	count;
+	double				mean;			// ns (all to within a bucket)
+	double				p50;
+	double				p99;
+	double				max;
+
+	StageSummary() {
+		count = 0;
+		mean = 0.0;
+		p50 = 0.0;
+		p99 = 0.0;
+		max = 0.0;
+	}
+};
+
+// Every stage's timings and every counter, merged over any number of StageStats
+struct StatsSnapshot
+{
+	unsigned long long	buckets[STAGE_COUNT][STAGE_BUCKETS];
+	unsigned long long	max[STAGE_COUNT];		// ns
+	unsigned long long	counters[COUNTER_COUNT];
+
+	StatsSnapshot();
+	void			Clear();
+	StageSummary	Summarize(TimedStage stage) const;
+};
+
+class StageStats
+{
+public:
+	// Constructors/destructors:
+	StageStats();
+
+	// Methods:
+	static unsigned long long	Now();
+	void	Record(TimedStage stage, unsigned long long start, unsigned long long end);
+	void	Count(StageCounter counter, unsigned int amount = 1);
+	void	AddTo(StatsSnapshot* snapshot) const;
+	static const char*	StageName(TimedStage stage);
+	static const char*	CounterName(StageCounter counter);
+	static int			Bucket(unsigned long long ns);
+	static double		BucketStart(int bucket);
+
+private:
+	// Private methods:
+	static void	Calibrate();
+
+	// Private variables:
+	std::atomic<unsigned int>	buckets[STAGE_COUNT][STAGE_BUCKETS];
+	std::atomic<unsigned int>	max[STAGE_COUNT];		// ns
+	std::atomic<unsigned int>	counters[COUNTER_COUNT];
+	static double	nsPerTick;			// clock ticks to ns, measured once
+};
\ No newline at end of file
@@ -0,0 +1,227 @@
+/**
+* @file		TargetEstimator.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The TargetEstimator class tunes to a known set of notes (e.g. a guitar's
+* strings) with a bank of Goertzel detectors at each note's fundamental and
+* first few harmonics, instead of a full FFT. The note with the most energy is
+* the one being played, and the phase each detector gains from one window to
+* the next gives its deviation from the target.
+**/
+
+#include "TargetEstimator.h"
+
+// Standard guitar tuning, low to high
+static const TargetNote standardTuning[] = {
+	{ "E2", 82.41 },
+	{ "A2", 110.00 },
+	{ "D3", 146.83 },
+	{ "G3", 196.00 },
+	{ "B3", 246.94 },
+	{ "E4", 329.63 }
+};
+
+// ****** Constructors:
+TargetEstimator::TargetEstimator(const TargetNote* notes, int count, int harmonics)
+{
+	if (notes == NULL || count <= 0) {
+		notes = StandardTuning(&count);
+	}
+
+	this->proc = NULL;
+	this->notes = notes;
+	this->count = std::min(count, PITCH_MAX_TARGETS);
+	this->harmonics = std::max(1, harmonics);
+	this->sampleRate = 0.0;
+	this->frames = 0;
+	this->window = NULL;
+	this->toneGain = 0.0;
+	this->previousValid = false;
+}
+
+// ****** Methods:
+// Set up the detectors for windows of 'frames' samples. Fails if the window is too short to tell
+// neighbouring target notes apart (their Hann main lobes, two bins either side, would overlap).
+int TargetEstimator::Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+							double maxfrequency, unsigned int plannerflags)
+{
+	if (frames <= 0 || samplerate <= 0.0) {
+		return -1;
+	}
+
+	double binSize = samplerate / frames;
+	for (int i = 0; i < this->count; i += 1) {
+		for (int j = i + 1; j < this->count; j += 1) {
+			if (fabs(this->notes[i].frequency - this->notes[j].frequency) < 2.0 * binSize) {
+				return -1;
+			}
+		}
+	}
+
+	this->window = proc->GetWindow(WINDOW_HANN, frames);
+	if (this->window == NULL) {
+		return -1;
+	}
+
+	this->proc = proc;
+	this->sampleRate = samplerate;
+	this->frames = frames;
+	this->windowed.assign(frames, 0);
+
+	// a sine of amplitude A gives |X|^2 = (A sum(w) / 2)^2 in its detector, out of a windowed energy of
+	// A^2 sum(w^2) / 2; noise spreads its energy over every bin instead
+	double sum = 0.0, squares = 0.0;
+	for (int i = 0; i < frames; i += 1) {
+		sum += this->window[i];
+		squares += this->window[i] * this->window[i];
+	}
+	this->toneGain = sum * sum / (2.0 * squares);
+
+	int total = this->count * this->harmonics;
+	this->detectors.resize(total);
+	this->coefficients.resize(total);
+	this->s1.resize(total);
+	this->s2.resize(total);
+	for (int n = 0; n < this->count; n += 1) {
+		for (int h = 1; h <= this->harmonics; h += 1) {
+			Detector& detector = this->detectors[n * this->harmonics + h - 1];
+			detector.omega = 2.0 * M_PI * h * this->notes[n].frequency / samplerate;
+			detector.cosw = cos(detector.omega);
+			detector.sinw = sin(detector.omega);
+			detector.cosr = cos(detector.omega * (frames - 1));
+			detector.sinr = -sin(detector.omega * (frames - 1));
+			detector.real = 0.0;
+			detector.imag = 0.0;
+
+			// a harmonic that sits on another target's fundamental (e.g. A2's third harmonic and E4)
+			// can't tell the two notes apart, so it doesn't count towards either
+			detector.shared = false;
+			for (int m = 0; m < this->count && h > 1; m += 1) {
+				if (m != n && fabs(h * this->notes[n].frequency - this->notes[m].frequency) < 2.0 * binSize) {
+					detector.shared = true;
+				}
+			}
+			this->coefficients[n * this->harmonics + h - 1] = 2.0 * detector.cosw;
+		}
+	}
+
+	this->Reset();
+	return 0;
+}
+
+// Find the target note being played and its deviation. Needs a previous window 'hop' samples back to
+// measure the deviation against, so the first window after a reset only reports the note.
+bool TargetEstimator::Estimate(const PitchInput& input, PitchEstimate* estimate)
+{
+	if (input.samples == NULL || input.frames != this->frames || this->window == NULL) {
+		return false;
+	}
+
+	// run the whole bank over the windowed samples
+	int total = (int)this->detectors.size();
+	AudioProcessor::ApplyWindow(input.samples, this->window, &this->windowed[0], this->frames);
+	std::fill(this->s1.begin(), this->s1.end(), 0.0);
+	std::fill(this->s2.begin(), this->s2.end(), 0.0);
+	AudioProcessor::Goertzel(&this->windowed[0], this->frames, &this->coefficients[0], total, &this->s1[0], &this->s2[0]);
+
+	// a harmonic's deviation is only trusted if the phase can resolve 50 cents either side of it
+	double range = (input.hop > 0) ? this->sampleRate / (2.0 * input.hop) : 0.0;
+	bool measure = (this->previousValid && input.hop > 0);
+
+	double energy = 0.0;
+	estimate->target = -1;
+	estimate->targets = this->count;
+	for (int n = 0; n < this->count; n += 1) {
+		double level = 0.0;
+		double weight = 0.0;
+		double cents = 0.0;
+
+		for (int h = 1; h <= this->harmonics; h += 1) {
+			int d = n * this->harmonics + h - 1;
+			Detector& detector = this->detectors[d];
+
+			// DFT term at omega, referred to the start of the window
+			double yr = this->s1[d] - detector.cosw * this->s2[d];
+			double yi = detector.sinw * this->s2[d];
+			double real = yr * detector.cosr - yi * detector.sinr;
+			double imag = yr * detector.sinr + yi * detector.cosr;
+			double power = (detector.shared ? 0.0 : real * real + imag * imag);
+			level += power;
+
+			// phase gained over the hop, beyond what the detector's own frequency accounts for
+			double frequency = h * this->notes[n].frequency;
+			if (measure && (h == 1 || frequency * (pow(2.0, 50.0 / 1200.0) - 1.0) < range)) {
+				double advance = atan2(imag * detector.real - real * detector.imag, real * detector.real + imag * detector.imag);
+				double deviation = advance - detector.omega * input.hop;
+				deviation -= 2.0 * M_PI * floor(deviation / (2.0 * M_PI) + 0.5);
+
+				double measured = (detector.omega + deviation / input.hop) * this->sampleRate / (2.0 * M_PI);
+				if (measured > 0.0 && power > 0.0) {
+					cents += power * 1200.0 * log(measured / frequency) / log(2.0);
+					weight += power;
+				}
+			}
+
+			detector.real = real;
+			detector.imag = imag;
+		}
+
+		estimate->targetCents[n] = (weight > 0.0) ? (cents / weight) : 0.0;
+		estimate->targetLevel[n] = level;
+		energy += level;
+		if (estimate->target < 0 || level > estimate->targetLevel[estimate->target]) {
+			estimate->target = n;
+		}
+	}
+	this->previousValid = true;
+
+	// levels as shares of the bank's energy; the played note's share is the confidence
+	for (int n = 0; n < this->count; n += 1) {
+		estimate->targetLevel[n] = (energy > 0.0) ? (estimate->targetLevel[n] / energy) : 0.0;
+	}
+	if (energy <= 0.0 || !measure) {
+		estimate->frequency = 0.0;
+		estimate->confidence = 0.0;
+		return true;
+	}
+
+	// the played note's share of the bank says which note it is, but with few targets noise alone
+	// often gives one of them most of the energy; so the confidence is also scaled by how much of the
+	// window's energy the note's partials hold (near 1 for a clean note, about 1/toneGain per
+	// detector for noise)
+	int target = estimate->target;
+	double power = 0.0;
+	for (int i = 0; i < this->frames; i += 1) {
+		power += (double)this->windowed[i] * this->windowed[i];
+	}
+	double tonality = (power > 0.0) ? estimate->targetLevel[target] * energy / (this->toneGain * power) : 0.0;
+	estimate->frequency = this->notes[target].frequency * pow(2.0, estimate->targetCents[target] / 1200.0);
+	estimate->confidence = estimate->targetLevel[target] * std::min(1.0, tonality);
+
+	return true;
+}
+
+// The windows either side of a gap are too far apart to compare phases
+void TargetEstimator::Reset()
+{
+	this->previousValid = false;
+}
+
+const char* TargetEstimator::Name() const
+{
+	return "Target";
+}
+
+// The bank works on the samples directly
+bool TargetEstimator::NeedsSpectrum() const
+{
+	return false;
+}
+
+// Standard guitar tuning (E2 A2 D3 G3 B3 E4)
+const TargetNote* TargetEstimator::StandardTuning(int* count)
+{
+	*count = sizeof(standardTuning) / sizeof(standardTuning[0]);
+	return standardTuning;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+/**
+* @file		TargetEstimator.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The TargetEstimator class tunes to a known set of notes (e.g. a guitar's
+* strings) with a bank of Goertzel detectors at each note's fundamental and
+* first few harmonics, instead of a full FFT. The note with the most energy is
+* the one being played, and the phase each detector gains from one window to
+* the next gives its deviation from the target.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <vector>
+
+// Local includes:
+#include "PitchEstimator.h"
+
+// Constants:
+#define TARGET_HARMONICS 3				// partials of each target note the bank listens to (default: 3)
+
+// A note to tune to
+struct TargetNote
+{
+	const char*	name;
+	double		frequency;				// Hz
+};
+
+class TargetEstimator : public PitchEstimator
+{
+public:
+	// Constructors/destructors:
+	// (with no notes, standard guitar tuning is used; the notes must outlive the estimator)
+	TargetEstimator(const TargetNote* notes = NULL, int count = 0, int harmonics = TARGET_HARMONICS);
+
+	// Methods:
+	int			Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+						double maxfrequency, unsigned int plannerflags);
+	bool		Estimate(const PitchInput& input, PitchEstimate* estimate);
+	void		Reset();
+	const char*	Name() const;
+	bool		NeedsSpectrum() const;
+
+	static const TargetNote*	StandardTuning(int* count);
+
+private:
+	// One detector of the bank
+	struct Detector
+	{
+		double	omega;					// frequency, in radians per sample
+		double	cosw;					// cos and sin of omega, for the final Goertzel step
+		double	sinw;
+		double	cosr;					// rotation referring the result to the start of the window
+		double	sinr;
+		double	real;					// DFT term of the previous window
+		double	imag;
+		bool	shared;					// a harmonic that lands on another target's fundamental
+	};
+
+	// Private variables:
+	AudioProcessor*		proc;
+	const TargetNote*	notes;
+	int					count;			// number of target notes
+	int					harmonics;		// detectors per note (the fundamental and its harmonics)
+	double				sampleRate;
+	int					frames;			// window size the bank was prepared for
+	const Sample*		window;			// Hann window table
+	double				toneGain;		// a bin-centred sine's power in its detector over its windowed energy
+	std::vector<Sample>	windowed;		// the windowed samples
+	std::vector<Detector>	detectors;	// note-major: note n's harmonic h is [n * harmonics + h - 1]
+	std::vector<double>	coefficients;	// 2 * cos(omega) of each detector
+	std::vector<double>	s1;				// Goertzel states
+	std::vector<double>	s2;
+	bool				previousValid;	// whether the detectors hold the previous window's terms
+};
\ No newline at end of file
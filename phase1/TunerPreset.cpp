@@ -0,0 +1,117 @@
+/**
+* @file		TunerPreset.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* Tuner presets bundle the analysis settings for one kind of instrument. Each
+* preset is a compile-time configuration, so the estimators specialised on it
+* have fixed buffer sizes and loop counts, but the presets themselves can be
+* switched between at run time.
+**/
+
+#include "TunerPreset.h"
+#include "PresetHPSEstimator.h"
+
+// ****** Methods:
+// Get the run-time settings of a preset
+TunerSettings TunerPreset::GetSettings(TunerPresetId preset)
+{
+	switch (preset) {
+	case PRESET_GUITAR:
+		return Describe<GuitarConfig>();
+	case PRESET_VOICE:
+		return Describe<VoiceConfig>();
+	case PRESET_BASS:
+	default:
+		return Describe<BassConfig>();
+	}
+}
+
+// Construct the estimator for the given method, specialised on the preset where there is a
+// specialisation ('refinement' only applies to HPS)
+PitchEstimator* TunerPreset::CreateEstimator(TunerPresetId preset, PitchMethod method, PitchRefinement refinement)
+{
+	switch (preset) {
+	case PRESET_GUITAR:
+		return Create<GuitarConfig>(method, refinement);
+	case PRESET_VOICE:
+		return Create<VoiceConfig>(method, refinement);
+	case PRESET_BASS:
+	default:
+		return Create<BassConfig>(method, refinement);
+	}
+}
+
+// Map a preset name ("bass", "guitar" or "voice") onto its TunerPresetId; returns false if unknown
+bool TunerPreset::ParsePreset(const std::string& name, TunerPresetId* preset)
+{
+	if (name == BassConfig::Name()) {
+		*preset = PRESET_BASS;
+	}
+	else if (name == GuitarConfig::Name()) {
+		*preset = PRESET_GUITAR;
+	}
+	else if (name == VoiceConfig::Name()) {
+		*preset = PRESET_VOICE;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+// Get the analysis window and hop a method uses under a preset: HPS needs a long window to resolve
+// low notes; the lag-domain estimators only need two periods, and target tuning only enough to tell
+// its notes apart
+void TunerPreset::GetWindow(const TunerSettings& settings, PitchMethod method, int* frames, int* hop)
+{
+	*frames = settings.frames;
+	*hop = settings.hop;
+	if (method == PITCH_TARGET) {
+		*frames = settings.targetFrames;
+		*hop = settings.targetHop;
+	}
+	else if (method != PITCH_HPS) {
+		*frames = settings.lagFrames;
+		*hop = settings.lagHop;
+	}
+}
+
+// Copy a configuration's constants into run-time settings
+template <class Config>
+TunerSettings TunerPreset::Describe()
+{
+	TunerSettings settings;
+	settings.name = Config::Name();
+	settings.sampleRate = Config::SAMPLE_RATE;
+	settings.frames = Config::FFT_SIZE;
+	settings.hop = Config::HOP;
+	settings.lagFrames = Config::LAG_FRAMES;
+	settings.lagHop = Config::LAG_HOP;
+	settings.targetFrames = Config::TARGET_FRAMES;
+	settings.targetHop = Config::TARGET_HOP;
+	settings.harmonics = Config::HARMONICS;
+	settings.minFrequency = Config::MIN_FREQUENCY;
+	settings.maxFrequency = Config::MAX_FREQUENCY;
+	settings.notes = Config::Tuning(&settings.noteCount);
+
+	return settings;
+}
+
+// HPS gets the specialised estimator and target tuning the preset's notes; the lag-domain
+// estimators size themselves in Prepare
+template <class Config>
+PitchEstimator* TunerPreset::Create(PitchMethod method, PitchRefinement refinement)
+{
+	if (method == PITCH_HPS) {
+		return new PresetHPSEstimator<Config>(refinement);
+	}
+	if (method == PITCH_TARGET) {
+		int count;
+		const TargetNote* notes = Config::Tuning(&count);
+		return new TargetEstimator(notes, count, TARGET_HARMONICS);
+	}
+
+	return PitchEstimator::Create(method, Config::HARMONICS, refinement);
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+/**
+* @file		TunerPreset.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* Tuner presets bundle the analysis settings for one kind of instrument. Each
+* preset is a compile-time configuration, so the estimators specialised on it
+* have fixed buffer sizes and loop counts, but the presets themselves can be
+* switched between at run time.
+*/
+
+#pragma once
+
+// Standard includes:
+#include <string>
+
+// Local includes:
+#include "PitchEstimator.h"
+#include "TargetEstimator.h"
+
+// Configurations:
+// Analysis rate (Hz), HPS window and hop, window and hop for the lag-domain estimators (two periods
+// of the lowest note, rounded up), window and hop for target tuning (enough to separate the closest
+// target notes), HPS harmonics, the note range (Hz) and the notes target tuning tunes to.
+struct BassConfig
+{
+	enum {
+		SAMPLE_RATE = 8000,
+		FFT_SIZE = 4096,
+		HOP = FFT_SIZE / 4,
+		LAG_FRAMES = 1024,
+		LAG_HOP = LAG_FRAMES / 4,
+		TARGET_FRAMES = 2048,
+		TARGET_HOP = TARGET_FRAMES / 4,
+		HARMONICS = 4,
+		MIN_FREQUENCY = 29,			// B0
+		MAX_FREQUENCY = 330			// E4
+	};
+	static const char* Name() { return "bass"; }
+	static const TargetNote* Tuning(int* count) {
+		static const TargetNote notes[] = { { "E1", 41.20 }, { "A1", 55.00 }, { "D2", 73.42 }, { "G2", 98.00 } };
+		*count = sizeof(notes) / sizeof(notes[0]);
+		return notes;
+	}
+};
+
+struct GuitarConfig
+{
+	enum {
+		SAMPLE_RATE = 8000,
+		FFT_SIZE = 2048,
+		HOP = FFT_SIZE / 4,
+		LAG_FRAMES = 256,
+		LAG_HOP = LAG_FRAMES / 4,
+		TARGET_FRAMES = 1024,
+		TARGET_HOP = TARGET_FRAMES / 4,
+		HARMONICS = 3,
+		MIN_FREQUENCY = 70,			// below drop-D's D2
+		MAX_FREQUENCY = 1000		// around the 22nd fret of the high E string
+	};
+	static const char* Name() { return "guitar"; }
+	static const TargetNote* Tuning(int* count) { return TargetEstimator::StandardTuning(count); }
+};
+
+struct VoiceConfig
+{
+	enum {
+		SAMPLE_RATE = 8000,
+		FFT_SIZE = 2048,
+		HOP = FFT_SIZE / 4,
+		LAG_FRAMES = 256,
+		LAG_HOP = LAG_FRAMES / 4,
+		TARGET_FRAMES = 1024,
+		TARGET_HOP = TARGET_FRAMES / 4,
+		HARMONICS = 4,
+		MIN_FREQUENCY = 80,			// E2
+		MAX_FREQUENCY = 880			// A5
+	};
+	static const char* Name() { return "voice"; }
+	static const TargetNote* Tuning(int* count) {
+		static const TargetNote notes[] = { { "C4", 261.63 }, { "D4", 293.66 }, { "E4", 329.63 }, { "F4", 349.23 },
+											{ "G4", 392.00 }, { "A4", 440.00 }, { "B4", 493.88 } };
+		*count = sizeof(notes) / sizeof(notes[0]);
+		return notes;
+	}
+};
+
+// Presets that can be chosen at run time (one per configuration above)
+enum TunerPresetId
+{
+	PRESET_BASS,
+	PRESET_GUITAR,
+	PRESET_VOICE
+};
+
+// A preset's configuration, as run-time values
+struct TunerSettings
+{
+	const char*	name;
+	int			sampleRate;			// analysis rate (Hz)
+	int			frames;				// HPS analysis window
+	int			hop;				// samples between HPS analyses
+	int			lagFrames;			// YIN/MPM analysis window
+	int			lagHop;				// samples between YIN/MPM analyses
+	int			targetFrames;		// target tuning window
+	int			targetHop;			// samples between target tuning analyses
+	int			harmonics;			// spectra multiplied together by HPS
+	double		minFrequency;		// the lowest frequency to consider
+	double		maxFrequency;		// the highest frequency to consider
+	const TargetNote*	notes;		// the notes target tuning tunes to
+	int			noteCount;
+
+	TunerSettings() {
+		name = "";
+		sampleRate = 0;
+		frames = 0;
+		hop = 0;
+		lagFrames = 0;
+		lagHop = 0;
+		targetFrames = 0;
+		targetHop = 0;
+		harmonics = 0;
+		minFrequency = 0.0;
+		maxFrequency = 0.0;
+		notes = NULL;
+		noteCount = 0;
+	}
+};
+
+class TunerPreset
+{
+public:
+	// Methods:
+	static TunerSettings	GetSettings(TunerPresetId preset);
+	static PitchEstimator*	CreateEstimator(TunerPresetId preset, PitchMethod method,
+											PitchRefinement refinement = REFINE_PHASE_VOCODER);
+	static bool				ParsePreset(const std::string& name, TunerPresetId* preset);
+	static void				GetWindow(const TunerSettings& settings, PitchMethod method, int* frames, int* hop);
+
+private:
+	// Private methods:
+	template <class Config> static TunerSettings	Describe();
+	template <class Config> static PitchEstimator*	Create(PitchMethod method, PitchRefinement refinement);
+};
\ No newline at end of file
@@ -0,0 +1,164 @@
+/**
+* @file		YINEstimator.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The YINEstimator class estimates the fundamental frequency with the YIN
+* algorithm (de Cheveigne & Kawahara), computing the difference function from
+* an FFT autocorrelation.
+**/
+
+#include "YINEstimator.h"
+
+// ****** Constructors:
+YINEstimator::YINEstimator(double threshold)
+{
+	this->proc = NULL;
+	this->threshold = threshold;
+	this->sampleRate = 0.0;
+	this->frames = 0;
+	this->length = 0;
+	this->minLag = 0;
+	this->maxLag = 0;
+	this->acf = NULL;
+	this->cmndf = NULL;
+}
+
+// ****** Destructor:
+YINEstimator::~YINEstimator()
+{
+	this->Release();
+}
+
+// ****** Methods:
+// Work out the lag range and analysis length, and plan the autocorrelation. Only about two periods
+// of the lowest frequency are needed, so this looks at a much shorter stretch than HPS.
+int YINEstimator::Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+						double maxfrequency, unsigned int plannerflags)
+{
+	if (frames <= 0 || samplerate <= 0.0 || minfrequency <= 0.0 || maxfrequency <= minfrequency) {
+		return -1;
+	}
+
+	int maxlag = (int)ceil(samplerate / minfrequency);
+	int length = LagWindow(maxlag, frames);
+	if (length == 0 || proc->PrepareAutocorrelation(length, plannerflags) != 0) {
+		return -1;
+	}
+
+	this->Release();
+	this->acf = (Sample*)FFTW(malloc)(sizeof(Sample) * (maxlag + 1));
+	this->cmndf = (double*)FFTW(malloc)(sizeof(double) * (maxlag + 1));
+	if (this->acf == NULL || this->cmndf == NULL) {
+		this->Release();
+		return -1;
+	}
+
+	this->proc = proc;
+	this->sampleRate = samplerate;
+	this->frames = frames;
+	this->length = length;
+	this->maxLag = maxlag;
+	this->minLag = std::max(2, (int)floor(samplerate / maxfrequency));
+
+	return 0;
+}
+
+// Find the shortest lag at which the signal best repeats itself
+bool YINEstimator::Estimate(const PitchInput& input, PitchEstimate* estimate)
+{
+	if (input.samples == NULL || input.frames != this->frames || this->acf == NULL) {
+		return false;
+	}
+
+	// analyse the most recent samples only, reusing the pipeline's autocorrelation if it has one
+	int n = this->length;
+	const Sample* x = input.samples + (input.frames - n);
+	const Sample* r = this->acf;
+	if (input.acf != NULL && n == input.frames && input.lags > this->maxLag) {
+		r = input.acf;
+	}
+	else {
+		this->proc->Autocorrelate(x, n, this->acf, this->maxLag + 1);
+	}
+
+	if (r[0] <= 0.0) {
+		// silence has no period
+		estimate->frequency = 0.0;
+		estimate->confidence = 0.0;
+		return true;
+	}
+
+	// difference function d(lag) = sum (x[j] - x[j + lag])^2 = m(lag) - 2 r(lag), where the energy
+	// term m(lag) = sum x[j]^2 + x[j + lag]^2 over the overlap is updated incrementally. It is taken
+	// per overlapping sample, so the shrinking overlap doesn't favour long lags.
+	double energy = 2.0 * r[0];
+	double sum = 0.0;
+	this->cmndf[0] = 1.0;
+	for (int lag = 1; lag <= this->maxLag; lag += 1) {
+		energy -= x[lag - 1] * x[lag - 1] + x[n - lag] * x[n - lag];
+		double difference = std::max(0.0, energy - 2.0 * r[lag]) / (double)(n - lag);
+
+		// cumulative mean normalisation
+		sum += difference;
+		this->cmndf[lag] = (sum > 0.0) ? difference * lag / sum : 1.0;
+	}
+
+	// the first dip below the threshold (followed down to its minimum) is the period; failing
+	// that, settle for the deepest dip
+	int best = -1;
+	for (int lag = this->minLag; lag <= this->maxLag; lag += 1) {
+		if (this->cmndf[lag] < this->threshold) {
+			while (lag + 1 <= this->maxLag && this->cmndf[lag + 1] < this->cmndf[lag]) {
+				lag += 1;
+			}
+			best = lag;
+			break;
+		}
+	}
+	if (best < 0) {
+		best = this->minLag;
+		for (int lag = this->minLag + 1; lag <= this->maxLag; lag += 1) {
+			if (this->cmndf[lag] < this->cmndf[best]) {
+				best = lag;
+			}
+		}
+	}
+
+	// refine the period between samples
+	double period = (double)best;
+	if (best > 1 && best < this->maxLag) {
+		period += ParabolicOffset(this->cmndf[best - 1], this->cmndf[best], this->cmndf[best + 1]);
+	}
+
+	estimate->frequency = this->sampleRate / period;
+	estimate->confidence = std::max(0.0, std::min(1.0, 1.0 - this->cmndf[best]));
+
+	return true;
+}
+
+const char* YINEstimator::Name() const
+{
+	return "YIN";
+}
+
+// Autocorrelation of the most recent 'length' samples, over lags 0 .. maxLag
+bool YINEstimator::Autocorrelation(int* length, int* lags) const
+{
+	if (this->acf == NULL) {
+		return false;
+	}
+
+	*length = this->length;
+	*lags = this->maxLag + 1;
+	return true;
+}
+
+// Free the lag-domain buffers
+void YINEstimator::Release()
+{
+	FFTW(free)(this->acf);
+	FFTW(free)(this->cmndf);
+	this->acf = NULL;
+	this->cmndf = NULL;
+}
\ No newline at end of file
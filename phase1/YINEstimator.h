@@ -0,0 +1,47 @@
+/**
+* @file		YINEstimator.h
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* The YINEstimator class estimates the fundamental frequency with the YIN
+* algorithm (de Cheveigne & Kawahara), computing the difference function from
+* an FFT autocorrelation.
+*/
+
+#pragma once
+
+// Local includes:
+#include "PitchEstimator.h"
+
+// Constants:
+#define YIN_THRESHOLD 0.15				// CMNDF dip that counts as a period (default: 0.15)
+
+class YINEstimator : public PitchEstimator
+{
+public:
+	// Constructors/destructors:
+	YINEstimator(double threshold = YIN_THRESHOLD);
+	~YINEstimator();
+
+	// Methods:
+	int			Prepare(AudioProcessor* proc, int frames, double samplerate, double minfrequency,
+						double maxfrequency, unsigned int plannerflags);
+	bool		Estimate(const PitchInput& input, PitchEstimate* estimate);
+	const char*	Name() const;
+	bool		Autocorrelation(int* length, int* lags) const;
+
+private:
+	// Private methods:
+	void		Release();
+
+	// Private variables:
+	AudioProcessor*	proc;
+	double			threshold;
+	double			sampleRate;
+	int				frames;			// window size the estimator was prepared for
+	int				length;			// number of (most recent) samples analysed
+	int				minLag;			// shortest period considered, in samples
+	int				maxLag;			// longest period considered, in samples
+	Sample*			acf;			// autocorrelation r(lag), 0 .. maxLag
+	double*			cmndf;			// cumulative mean normalised difference d'(lag), 0 .. maxLag
+};
\ No newline at end of file
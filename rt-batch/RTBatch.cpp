@@ -0,0 +1,249 @@
+/**
+* @file		RTBatch.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* RTBatch is the driver for the headless batch analyzer: it runs recorded WAV
+* or raw PCM files through the live tuner's analysis chain and writes a pitch
+* track for each one. It can also check the chain's accuracy on synthetic
+* signals against a stored baseline, and check a build's readings window by
+* window against a reference track from the double-precision build.
+*/
+
+// Local includes:
+#include "BatchAnalyzer.h"
+#include "AccuracyCheck.h"
+
+// Standard includes:
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Print the command-line usage
+static void PrintUsage()
+{
+	std::cout << "Usage: rt-batch [options] <file> [<file> ...]\n"
+		<< "       rt-batch --accuracy [--preset ...] [--pitch ...] [--baseline <path>] [--save-baseline <path>]\n"
+		<< "                           [--track <path>] [--save-track <path>]\n"
+		<< "  --preset bass|guitar|voice             instrument preset (as in the live tuner)\n"
+		<< "  --pitch hps|yin|mpm|target             pitch estimator\n"
+		<< "  --threads <count>                      analysis threads (default: one per core)\n"
+		<< "  --chunk <seconds>                      audio each thread takes at a time (default: " << BATCH_CHUNK_SECONDS << ")\n"
+		<< "  --channel <n>                          analyse channel n (from 1) rather than the mix of all of them\n"
+		<< "  --raw <rate> <channels> s16|s24|s32|f32|f64   read headerless PCM rather than WAV\n"
+		<< "  --output <path>                        where to write the pitch track (one file only; default: <file>.pitch.csv)\n"
+		<< "  --wisdom <path>                        FFTW wisdom store (default: " << FFT_WISDOM_FILENAME << " next to rt-batch)\n"
+		<< "  --accuracy                             play synthetic signals through every preset and estimator (or the\n"
+		<< "                                         ones chosen) and report their accuracy, rather than analysing files\n"
+		<< "  --baseline <path>                      fail if any accuracy metric is worse than this baseline's\n"
+		<< "  --save-baseline <path>                 write the accuracy results as a new baseline\n"
+		<< "  --track <path>                         fail if any window's reading is more than " << ACCURACY_TRACK_CENTS << " cents from this\n"
+		<< "                                         reference track's (e.g. a float32 build against the double one)\n"
+		<< "  --save-track <path>                    write every window's reading as a new reference track (double\n"
+		<< "                                         precision builds only)\n";
+}
+
+// Check the accuracy of one preset and estimator, or (given -1) of every one, and compare it with a
+// baseline and the readings with a reference track, if there are any
+static int RunAccuracy(int preset, int method, const std::string& baseline, const std::string& saveBaseline,
+						const std::string& track, const std::string& saveTrack)
+{
+	// the reference is what the single-precision build is held to
+	if (!saveTrack.empty() && sizeof(Sample) != sizeof(double)) {
+		std::cout << "***Problem: reference tracks have to come from the double-precision build\n";
+		return EXIT_FAILURE;
+	}
+
+	static const TunerPresetId presets[] = { PRESET_BASS, PRESET_GUITAR, PRESET_VOICE };
+	static const PitchMethod methods[] = { PITCH_HPS, PITCH_YIN, PITCH_MPM, PITCH_TARGET };
+
+	std::vector<AccuracyResult> results;
+	std::vector<AccuracyReading> readings;
+	for (int p = 0; p < 3; p += 1) {
+		for (int m = 0; m < 4; m += 1) {
+			if ((preset >= 0 && presets[p] != preset) || (method >= 0 && methods[m] != method)) {
+				continue;
+			}
+			AccuracyCheck check(presets[p], methods[m]);
+			if (!track.empty() || !saveTrack.empty()) {
+				check.SetReadings(&readings);
+			}
+			if (check.Run(&results) != 0) {
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	AccuracyCheck::PrintResults(results);
+
+	if (!saveBaseline.empty() && AccuracyCheck::WriteResults(results, saveBaseline) != 0) {
+		return EXIT_FAILURE;
+	}
+	if (!baseline.empty()) {
+		int regressions = AccuracyCheck::Compare(results, baseline);
+		if (regressions != 0) {
+			if (regressions > 0) {
+				std::cout << regressions << " regressions against " << baseline << "\n";
+			}
+			return EXIT_FAILURE;
+		}
+		std::cout << "No regressions against " << baseline << "\n";
+	}
+
+	if (!saveTrack.empty() && AccuracyCheck::WriteReadings(readings, saveTrack) != 0) {
+		return EXIT_FAILURE;
+	}
+	if (!track.empty() && AccuracyCheck::CompareReadings(readings, track) != 0) {
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+	TunerPresetId preset = TUNER_PRESET;
+	PitchMethod method = PITCH_METHOD;
+	int threads = 0;
+	double chunkSeconds = BATCH_CHUNK_SECONDS;
+	int channel = AUDIO_FILE_MIX;
+	bool useRaw = false;
+	AudioFileFormat raw;
+	std::string output;
+	std::vector<std::string> files;
+	bool accuracy = false;
+	bool presetChosen = false;
+	bool methodChosen = false;
+	std::string baseline;
+	std::string saveBaseline;
+	std::string track;
+	std::string saveTrack;
+
+	// the wisdom store is shared with the live tuner's, when they sit side by side
+	std::string program(argv[0]);
+	size_t slash = program.find_last_of("\\/");
+	std::string wisdom = ((slash == std::string::npos) ? std::string() : program.substr(0, slash + 1)) + FFT_WISDOM_FILENAME;
+
+	for (int i = 1; i < argc; i += 1) {
+		std::string option(argv[i]);
+		std::string name = (i + 1 < argc) ? std::string(argv[i + 1]) : "";
+
+		if (option == "--preset") {
+			if (!TunerPreset::ParsePreset(name, &preset)) {
+				std::cout << "Unknown preset: " << name << " (expected bass, guitar or voice)\n";
+				return EXIT_FAILURE;
+			}
+			presetChosen = true;
+			i += 1;
+		}
+		else if (option == "--pitch") {
+			if (!PitchEstimator::ParseMethod(name, &method)) {
+				std::cout << "Unknown pitch estimator: " << name << " (expected hps, yin, mpm or target)\n";
+				return EXIT_FAILURE;
+			}
+			methodChosen = true;
+			i += 1;
+		}
+		else if (option == "--threads") {
+			threads = atoi(name.c_str());
+			i += 1;
+		}
+		else if (option == "--chunk") {
+			chunkSeconds = atof(name.c_str());
+			if (chunkSeconds <= 0.0) {
+				std::cout << "Invalid chunk length: " << name << "\n";
+				return EXIT_FAILURE;
+			}
+			i += 1;
+		}
+		else if (option == "--channel") {
+			channel = atoi(name.c_str()) - 1;
+			if (channel < 0) {
+				std::cout << "Invalid channel: " << name << "\n";
+				return EXIT_FAILURE;
+			}
+			i += 1;
+		}
+		else if (option == "--raw") {
+			if (i + 3 >= argc || !AudioFileReader::ParseEncoding(argv[i + 3], &raw.encoding)) {
+				std::cout << "--raw needs a rate, a channel count and an encoding (s16, s24, s32, f32 or f64)\n";
+				return EXIT_FAILURE;
+			}
+			raw.sampleRate = atoi(argv[i + 1]);
+			raw.channels = atoi(argv[i + 2]);
+			useRaw = true;
+			i += 3;
+		}
+		else if (option == "--output") {
+			output = name;
+			i += 1;
+		}
+		else if (option == "--wisdom") {
+			wisdom = name;
+			i += 1;
+		}
+		else if (option == "--accuracy") {
+			accuracy = true;
+		}
+		else if (option == "--baseline") {
+			baseline = name;
+			i += 1;
+		}
+		else if (option == "--save-baseline") {
+			saveBaseline = name;
+			i += 1;
+		}
+		else if (option == "--track") {
+			track = name;
+			i += 1;
+		}
+		else if (option == "--save-track") {
+			saveTrack = name;
+			i += 1;
+		}
+		else if (option == "--help" || option == "-h") {
+			PrintUsage();
+			return EXIT_SUCCESS;
+		}
+		else if (option.compare(0, 2, "--") == 0) {
+			std::cout << "Ignoring unknown option: " << option << "\n";
+		}
+		else {
+			files.push_back(option);
+		}
+	}
+
+	if (accuracy) {
+		return RunAccuracy(presetChosen ? (int)preset : -1, methodChosen ? (int)method : -1, baseline, saveBaseline,
+						track, saveTrack);
+	}
+
+	if (files.empty() || (!output.empty() && files.size() > 1)) {
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	BatchAnalyzer analyzer(preset, method);
+	analyzer.SetThreads(threads);
+	analyzer.SetChunkSeconds(chunkSeconds);
+	analyzer.SetChannel(channel);
+	analyzer.SetWisdomFile(wisdom);
+
+	int failures = 0;
+	for (size_t i = 0; i < files.size(); i += 1) {
+		std::vector<PitchPoint> track;
+		BatchStats stats;
+		std::string path = output.empty() ? (files[i] + ".pitch.csv") : output;
+		if (analyzer.Analyze(files[i], useRaw ? &raw : NULL, &track, &stats) != 0 ||
+			BatchAnalyzer::WriteTrack(track, path) != 0) {
+			failures += 1;
+			continue;
+		}
+
+		printf("%s: %.1f s of audio in %.2f s (%.1fx realtime), %d windows, %d chunks on %d threads -> %s\n",
+			files[i].c_str(), stats.duration, stats.elapsed, stats.realtime, stats.windows, stats.chunks, stats.threads,
+			path.c_str());
+	}
+
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,376 @@
+/**
+* @file		RTBench.cpp
+* @author	Justin Hoggart <jwhoggart@gmail.com>
+* @version	1.0
+*
+* RTBench times each stage of the analysis chain (window, FFT, log spectrum,
+* HPS, low-pass filter, decimator) and the whole capture-callback chain, over
+* a range of FFT sizes and harmonic counts, and reports the cost per sample
+* and the spread of the cost per block. The JSON it can write is meant to be
+* diffed between builds (e.g. the double and ANALYSIS_FLOAT32 ones). It also
+* counts heap allocations in the timed blocks, and fails if there are any,
+* since the capture chain has to run in the audio callback. The count covers
+* operator new and new[] only: malloc and FFTW(malloc) are not counted.
+*/
+
+// Local includes:
+#include "AnalysisConfig.h"
+#include "AnalysisPipeline.h"
+#include "HPSEstimator.h"
+
+// Standard includes:
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <new>
+
+// Platform includes (for a high-resolution clock):
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// Constants:
+#define BENCH_MIN_TIME 0.25				// seconds each measurement runs for, at least (default: 0.25)
+#define BENCH_MIN_BLOCKS 50				// blocks each measurement times, at least (default: 50)
+#define BENCH_WARMUP_BLOCKS 10			// untimed blocks before each measurement
+#define BENCH_DEVICE_RATE 48000			// device rate the capture chain decimates from (Hz)
+#define BENCH_ANALYSIS_RATE 8000		// analysis rate of the stages and the generic capture chain (Hz)
+#define BENCH_MIN_HARMONICS 2			// range of HPS harmonic counts timed
+#define BENCH_MAX_HARMONICS 5
+
+// FFT sizes timed
+static const int fftSizes[] = { 1024, 2048, 4096, 8192, 16384 };
+
+// One measurement
+struct BenchResult
+{
+	std::string	stage;
+	int			fftSize;				// 0 where the stage doesn't depend on it
+	int			harmonics;				// 0 where the stage doesn't depend on it
+	std::string	preset;					// the capture chain's preset, if any
+	std::string	estimator;				// and its pitch estimator
+	int			block;					// samples per timed block
+	int			blocks;					// blocks timed
+	double		nsPerSample;			// mean
+	double		p50;					// per block (ns)
+	double		p99;
+	double		max;
+	long		allocations;			// heap allocations in the timed blocks
+};
+
+// Allocation counting: the global operator new counts while 'countAllocations' is set. The bench is
+// single-threaded, so plain variables do. Only the C++ heap is seen (not FFTW(malloc) or malloc).
+static bool countAllocations = false;
+static long allocations = 0;
+
+void* operator new(size_t size)
+{
+	if (countAllocations) {
+		allocations += 1;
+	}
+	void* p = malloc((size > 0) ? size : 1);
+	if (p == NULL) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p)
+{
+	free(p);
+}
+
+void operator delete[](void* p)
+{
+	free(p);
+}
+
+// Nanoseconds on a monotonic clock (VS2013's high_resolution_clock only ticks every millisecond or so)
+static double Now()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER count;
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&count);
+	return count.QuadPart * (1e9 / frequency.QuadPart);
+#else
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Time 'body' one block of 'block' samples at a time, for at least BENCH_MIN_TIME seconds
+static BenchResult Measure(const std::string& stage, int fftsize, int harmonics, int block, std::function<void()> body,
+						const std::string& preset = std::string(), const std::string& estimator = std::string())
+{
+	for (int i = 0; i < BENCH_WARMUP_BLOCKS; i += 1) {
+		body();
+	}
+
+	// count only inside the blocks (recording the times allocates)
+	std::vector<double> times;
+	double total = 0.0;
+	allocations = 0;
+	while (total < BENCH_MIN_TIME * 1e9 || (int)times.size() < BENCH_MIN_BLOCKS) {
+		double start = Now();
+		countAllocations = true;
+		body();
+		countAllocations = false;
+		double elapsed = Now() - start;
+		times.push_back(elapsed);
+		total += elapsed;
+	}
+	std::sort(times.begin(), times.end());
+
+	BenchResult result;
+	result.stage = stage;
+	result.fftSize = fftsize;
+	result.harmonics = harmonics;
+	result.preset = preset;
+	result.estimator = estimator;
+	result.block = block;
+	result.blocks = (int)times.size();
+	result.nsPerSample = total / ((double)times.size() * block);
+	result.p50 = times[times.size() / 2];
+	result.p99 = times[std::min(times.size() - 1, (size_t)(times.size() * 0.99))];
+	result.max = times.back();
+	result.allocations = allocations;
+
+	printf("%-16s %6d %3d %-7s %-6s %7d  %9.3f ns/sample  p50 %10.0f  p99 %10.0f  max %10.0f ns/block  %ld allocs\n",
+		stage.c_str(), fftsize, harmonics, result.preset.c_str(), result.estimator.c_str(), block, result.nsPerSample, result.p50,
+		result.p99, result.max, result.allocations);
+	return result;
+}
+
+// A deterministic test signal: a few harmonics of a low note, plus a little noise
+static void FillSignal(Sample* data, int count, double samplerate)
+{
+	unsigned int seed = 12345;
+	for (int i = 0; i < count; i += 1) {
+		double t = i / samplerate;
+		seed = seed * 1664525 + 1013904223;
+		double noise = ((seed >> 8) / 16777216.0 - 0.5) * 0.01;
+		data[i] = (Sample)(0.3 * sin(2 * M_PI * 110.0 * t) + 0.2 * sin(2 * M_PI * 220.0 * t) +
+			0.1 * sin(2 * M_PI * 330.0 * t) + noise);
+	}
+}
+
+// Time the stages that work on one window of 'fftsize' samples
+static void BenchStages(int fftsize, std::vector<BenchResult>* results)
+{
+	AudioProcessor proc;
+	proc.PrepareFFT(fftsize, FFT_PLANNER_FLAGS);
+	const Sample* window = proc.GetWindow(WINDOW_HANN, fftsize);
+	int bins = fftsize / 2 + 1;
+	double samplerate = BENCH_ANALYSIS_RATE;
+
+	std::vector<Sample> data(fftsize), out(fftsize), spectrum(bins), logspectrum(bins), scratch(2 * bins);
+	std::vector<SampleComplex> transform(bins);
+	std::vector<double> legacy(fftsize), legacySpectrum(bins), legacyScratch(2 * bins);
+	FillSignal(&data[0], fftsize, samplerate);
+
+	results->push_back(Measure("window", fftsize, 0, fftsize, [&]() {
+		AudioProcessor::ApplyWindow(&data[0], window, &out[0], fftsize);
+	}));
+	results->push_back(Measure("window_legacy", fftsize, 0, fftsize, [&]() {
+		std::copy(data.begin(), data.end(), legacy.begin());
+		AudioProcessor::ApplyWindowFunction(&legacy[0], fftsize);
+	}));
+	results->push_back(Measure("fft", fftsize, 0, fftsize, [&]() {
+		proc.PerformFFT(&data[0], fftsize, &spectrum[0], window, SPECTRUM_MAGNITUDE, &transform[0]);
+	}));
+	results->push_back(Measure("log_spectrum", fftsize, 0, fftsize, [&]() {
+		AudioProcessor::LogSpectrum(&spectrum[0], &logspectrum[0], bins, 1.0);
+	}));
+
+	for (int i = 0; i < bins; i += 1) {
+		legacySpectrum[i] = spectrum[i];
+	}
+	for (int h = BENCH_MIN_HARMONICS; h <= BENCH_MAX_HARMONICS; h += 1) {
+		results->push_back(Measure("hps", fftsize, h, fftsize, [&]() {
+			proc.LogHPS(&logspectrum[0], bins, h, &scratch[0]);
+		}));
+		results->push_back(Measure("hps_legacy", fftsize, h, fftsize, [&]() {
+			proc.HPS(&legacySpectrum[0], bins, h, &legacyScratch[0]);
+		}));
+	}
+
+	// the filters run continuously, so their state carries over from block to block
+	LowPassFilter filter;
+	filter.SetParams(samplerate, 1000.0);
+	results->push_back(Measure("lowpass", fftsize, 0, fftsize, [&]() {
+		filter.Process(&data[0], &out[0], fftsize);
+	}));
+
+	double a[2], b[3];
+	double mem1[4] = { 0.0, 0.0, 0.0, 0.0 };
+	double mem2[4] = { 0.0, 0.0, 0.0, 0.0 };
+	AudioProcessor::CalcLowPassParams(samplerate, 1000.0, a, b);
+	results->push_back(Measure("lowpass_legacy", fftsize, 0, fftsize, [&]() {
+		for (int i = 0; i < fftsize; i += 1) {
+			legacy[i] = AudioProcessor::LowPass(AudioProcessor::LowPass(data[i], mem1, a, b), mem2, a, b);
+		}
+	}));
+}
+
+// Time the decimator, from the device rate to the analysis rate, on a window's worth of output
+static void BenchDecimator(int fftsize, std::vector<BenchResult>* results)
+{
+	int factor = BENCH_DEVICE_RATE / BENCH_ANALYSIS_RATE;
+	std::vector<Sample> in(fftsize * factor), out(fftsize);
+	FillSignal(&in[0], (int)in.size(), BENCH_DEVICE_RATE);
+
+	Decimator decimator;
+	decimator.SetParams(factor, BENCH_DEVICE_RATE, 1000.0);
+	results->push_back(Measure("decimator", fftsize, 0, (int)in.size(), [&]() {
+		decimator.Process(&in[0], (int)in.size(), &out[0]);
+	}));
+}
+
+// Time what the capture callback does with each device buffer (decimate, slide, gate, window, FFT,
+// estimate and publish), analysing directly in the callback as AUDIO_USE_DSP_WORKER false does. Each
+// block is one device buffer, so the spread shows the buffers that complete a window.
+static BenchResult BenchChain(const std::string& name, const std::string& preset, PitchEstimator* estimator, int harmonics,
+							int samplerate, int fftsize, int hop, double minfrequency, double maxfrequency)
+{
+	int factor = BENCH_DEVICE_RATE / samplerate;
+	AudioProcessor proc;
+	ProcessingContext context(fftsize, hop);
+	AnalysisRing results(ANALYSIS_RING_FRAMES);
+	AnalysisPipeline pipeline(&proc, &context, &results, samplerate, minfrequency, maxfrequency, ANALYSIS_WINDOW);
+	pipeline.SetEstimator(estimator);
+	pipeline.SetGate(AUDIO_USE_GATE);
+	pipeline.SetInputRate(BENCH_DEVICE_RATE, factor);
+	pipeline.Prepare(FFT_PLANNER_FLAGS);
+
+	// a few seconds of signal, played round in device-sized buffers
+	int block = AUDIO_DEVICE_FRAMES * factor;
+	std::vector<Sample> signal(BENCH_DEVICE_RATE * 4 / block * block);
+	FillSignal(&signal[0], (int)signal.size(), BENCH_DEVICE_RATE);
+	size_t position = 0;
+
+	return Measure(name, fftsize, harmonics, block, [&]() {
+		pipeline.PushSamples(&signal[position], block);
+		position = (position + block) % signal.size();
+		AnalysisFrame frame;
+		while (results.Pop(frame)) {
+		}
+	}, preset, estimator->Name());
+}
+
+// Write the results as JSON
+static int WriteJson(const std::vector<BenchResult>& results, const std::string& path)
+{
+	FILE* file = (path == "-") ? stdout : fopen(path.c_str(), "w");
+	if (file == NULL) {
+		std::cout << "***Problem writing " << path << "\n";
+		return -1;
+	}
+
+#if defined(_MSC_VER)
+	int compiler = _MSC_VER;
+	const char* compilerName = "msvc";
+#elif defined(__GNUC__)
+	int compiler = __GNUC__ * 100 + __GNUC_MINOR__;
+	const char* compilerName = "gcc";
+#else
+	int compiler = 0;
+	const char* compilerName = "unknown";
+#endif
+	fprintf(file, "{\n  \"build\": {\"sample\": \"%s\", \"sse2\": %s, \"compiler\": \"%s\", \"compiler_version\": %d},\n",
+		(sizeof(Sample) == sizeof(float)) ? "float32" : "float64", SimdHasSSE2() ? "true" : "false", compilerName, compiler);
+	fprintf(file, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); i += 1) {
+		const BenchResult& r = results[i];
+		fprintf(file, "    {\"stage\": \"%s\", \"fft_size\": %d, \"harmonics\": %d, \"preset\": \"%s\", \"estimator\": \"%s\", \"block\": %d, "
+			"\"blocks\": %d, \"ns_per_sample\": %.4f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"max_ns\": %.0f, \"allocations\": %ld}%s\n",
+			r.stage.c_str(), r.fftSize, r.harmonics, r.preset.c_str(), r.estimator.c_str(), r.block, r.blocks, r.nsPerSample,
+			r.p50, r.p99, r.max, r.allocations, (i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+
+	if (file != stdout) {
+		fclose(file);
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string json;
+	for (int i = 1; i < argc; i += 1) {
+		std::string option(argv[i]);
+		if (option == "--json" && i + 1 < argc) {
+			json = argv[i + 1];
+			i += 1;
+		}
+		else {
+			std::cout << "Usage: rt-bench [--json <path>|-]\n";
+			return (option == "--help" || option == "-h") ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	printf("%s samples, SSE2 %s\n", (sizeof(Sample) == sizeof(float)) ? "float32" : "float64", SimdHasSSE2() ? "on" : "off");
+	printf("%-16s %6s %3s %-7s %-6s %7s\n", "stage", "fft", "h", "preset", "pitch", "block");
+
+	std::vector<BenchResult> results;
+	for (size_t i = 0; i < sizeof(fftSizes) / sizeof(fftSizes[0]); i += 1) {
+		BenchStages(fftSizes[i], &results);
+		BenchDecimator(fftSizes[i], &results);
+
+		// the capture chain with a generic 4-harmonic HPS at every size
+		HPSEstimator estimator(4, PITCH_REFINEMENT);
+		results.push_back(BenchChain("chain", "", &estimator, 4, BENCH_ANALYSIS_RATE, fftSizes[i], fftSizes[i] / 4,
+									29.0, 1000.0));
+	}
+
+	// and with each preset's own configuration, with every estimator --pitch can choose for the live
+	// tuner (each on the window and hop the capturer gives it), so that none of them may allocate
+	TunerPresetId presets[] = { PRESET_BASS, PRESET_GUITAR, PRESET_VOICE };
+	PitchMethod methods[] = { PITCH_HPS, PITCH_YIN, PITCH_MPM, PITCH_TARGET };
+	for (int i = 0; i < 3; i += 1) {
+		TunerSettings settings = TunerPreset::GetSettings(presets[i]);
+		for (int m = 0; m < 4; m += 1) {
+			int frames, hop;
+			TunerPreset::GetWindow(settings, methods[m], &frames, &hop);
+			PitchEstimator* estimator = TunerPreset::CreateEstimator(presets[i], methods[m], PITCH_REFINEMENT);
+			int harmonics = (methods[m] == PITCH_HPS) ? settings.harmonics : 0;
+			results.push_back(BenchChain("chain_preset", settings.name, estimator, harmonics, settings.sampleRate, frames, hop,
+										settings.minFrequency, settings.maxFrequency));
+			delete estimator;
+		}
+	}
+
+	if (!json.empty() && WriteJson(results, json) != 0) {
+		return EXIT_FAILURE;
+	}
+
+	// nothing timed may allocate (the capture chain runs in the audio callback)
+	int status = EXIT_SUCCESS;
+	for (size_t i = 0; i < results.size(); i += 1) {
+		const BenchResult& r = results[i];
+		if (r.allocations > 0) {
+			printf("***Problem: %s %d %s %s allocated %ld times in %d blocks\n", r.stage.c_str(), r.fftSize, r.preset.c_str(),
+				r.estimator.c_str(), r.allocations, r.blocks);
+			status = EXIT_FAILURE;
+		}
+	}
+
+	return status;
+}
\ No newline at end of file